@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+
+/*
+   Evaluation of permissions against requested accesses
+   Checks are specialized at compile time on requested right and interval mode, so each action gets straight line
+   code without comparisons against every right. Kept free of eosiolib, so that it can be benchmarked on the host
+*/
+namespace access
+{
+   /* Rights as bits, right ids READ = 0, WRITE = 1, READ_WRITE = 2 map to their bit sets by adding 1 */
+   enum right_bits : uint8_t
+   {
+      READ_BIT = 1,
+      WRITE_BIT = 2
+   };
+
+   constexpr uint8_t bits_of(uint8_t right) noexcept
+   {
+      return right + 1;
+   }
+
+   /* Write rights need a single specialty and can't start in the past */
+   constexpr bool has_write(uint8_t right) noexcept
+   {
+      return bits_of(right) & WRITE_BIT;
+   }
+
+   enum class interval_mode
+   {
+      /* Access at one moment, used for writes and notifications */
+      POINT,
+      /* Access to records of a whole interval, used for reads */
+      CONTAINMENT
+   };
+
+   /* Does permission interval cover requested one, infinite permission interval covers everything */
+   template <interval_mode Mode>
+   constexpr bool covers(uint32_t perm_from, uint32_t perm_to, uint32_t from, uint32_t to) noexcept
+   {
+      const bool is_infinite = (perm_from | perm_to) == 0;
+      if constexpr (Mode == interval_mode::POINT)
+         return is_infinite | ((from >= perm_from) & (from <= perm_to));
+      else
+         return is_infinite | ((from >= perm_from) & (to <= perm_to));
+   }
+
+   /* Specialization of the check for requested right bit and interval mode */
+   template <uint8_t RightBit, interval_mode Mode>
+   struct check
+   {
+      template <typename Permission>
+      static constexpr bool allows(const Permission &permission, uint32_t from, uint32_t to) noexcept
+      {
+         return ((bits_of(permission.right) & RightBit) != 0) & covers<Mode>(permission.interval.from, permission.interval.to, from, to);
+      }
+
+      template <typename Permission>
+      static constexpr bool allows_at(const Permission &permission, uint32_t moment) noexcept
+      {
+         return allows(permission, moment, moment);
+      }
+   };
+
+   using read_check = check<READ_BIT, interval_mode::CONTAINMENT>;
+   using write_check = check<WRITE_BIT, interval_mode::POINT>;
+   using read_at_check = check<READ_BIT, interval_mode::POINT>;
+
+   /* Fixed width set of specialty ids, specialty ids are uint8 */
+   struct specialty_set
+   {
+      uint64_t words[4] = {0, 0, 0, 0};
+
+      void insert(uint8_t specialtyid) noexcept
+      {
+         words[specialtyid >> 6] |= uint64_t(1) << (specialtyid & 63);
+      }
+      bool contains(uint8_t specialtyid) const noexcept
+      {
+         return (words[specialtyid >> 6] >> (specialtyid & 63)) & 1;
+      }
+      bool empty() const noexcept
+      {
+         return (words[0] | words[1] | words[2] | words[3]) == 0;
+      }
+      bool operator==(const specialty_set &other) const noexcept
+      {
+         return ((words[0] ^ other.words[0]) | (words[1] ^ other.words[1]) | (words[2] ^ other.words[2]) | (words[3] ^ other.words[3])) == 0;
+      }
+
+      /* Adds specialties of granted ones which are also requested */
+      template <typename SpecialtyIds>
+      void add_granted(const SpecialtyIds &granted, const specialty_set &requested) noexcept
+      {
+         for (const auto specialtyid : granted)
+            words[specialtyid >> 6] |= requested.words[specialtyid >> 6] & (uint64_t(1) << (specialtyid & 63));
+      }
+
+      template <typename Visitor>
+      void for_each(Visitor &&visitor) const
+      {
+         for (unsigned word = 0; word < 4; word++)
+            for (auto bits = words[word]; bits != 0; bits &= bits - 1)
+               visitor(static_cast<uint8_t>(word * 64 + __builtin_ctzll(bits)));
+      }
+   };
+} // namespace access
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+   Bump allocator for transient allocations made during a single action invocation
+   Memory is handed out from a static buffer by advancing an offset, so allocation is a couple of additions and
+   deallocation is free; only the most recent block is given back, all the others are released wholesale when
+   the scope of the action ends. When the buffer is exhausted allocations fall back to the general-purpose allocator.
+   Builds defining ACTION_ARENA_DISABLED send every allocation there, as a baseline to measure the arena against
+*/
+struct action_arena
+{
+   static constexpr inline size_t CAPACITY = 32 * 1024;
+   static constexpr inline size_t ALIGNMENT = alignof(std::max_align_t);
+
+   static void *allocate(const size_t size) noexcept
+   {
+#ifndef ACTION_ARENA_DISABLED
+      const auto aligned_size = align(size);
+      /* Strictly less, so that even an empty block never points past the buffer, where owns() wouldn't recognize it */
+      if (aligned_size < CAPACITY - m_offset)
+      {
+         const auto block = m_buffer + m_offset;
+         m_offset += aligned_size;
+         return block;
+      }
+#endif
+      return ::operator new(size);
+   }
+
+   static void deallocate(void *block, const size_t size) noexcept
+   {
+      if (!owns(block))
+      {
+         ::operator delete(block);
+         return;
+      }
+      /* Give back only the top of the arena, common for growing vectors and strings */
+      if (static_cast<char *>(block) + align(size) == m_buffer + m_offset)
+         m_offset -= align(size);
+   }
+
+   static bool owns(const void *block) noexcept
+   {
+      return block >= m_buffer && block < m_buffer + CAPACITY;
+   }
+
+   static void release() noexcept
+   {
+      m_offset = 0;
+   }
+
+   /* Releases the arena wholesale when action ends */
+   struct scope
+   {
+      scope() noexcept = default;
+      scope(const scope &) = delete;
+      scope &operator=(const scope &) = delete;
+      ~scope() noexcept { release(); }
+   };
+
+private:
+   static constexpr size_t align(const size_t size) noexcept
+   {
+      return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+   }
+
+#ifdef __wasm__
+   alignas(ALIGNMENT) static inline char m_buffer[CAPACITY];
+   static inline size_t m_offset = 0;
+#else
+   /* Host builds of the contract may run actions of several chains on parallel threads */
+   alignas(ALIGNMENT) static inline thread_local char m_buffer[CAPACITY];
+   static inline thread_local size_t m_offset = 0;
+#endif
+};
+
+template <typename T>
+struct arena_allocator
+{
+   using value_type = T;
+
+   arena_allocator() noexcept = default;
+   template <typename U>
+   arena_allocator(const arena_allocator<U> &) noexcept {}
+
+   T *allocate(const size_t count) noexcept
+   {
+      return static_cast<T *>(action_arena::allocate(count * sizeof(T)));
+   }
+
+   void deallocate(T *block, const size_t count) noexcept
+   {
+      action_arena::deallocate(block, count * sizeof(T));
+   }
+
+   template <typename U>
+   friend bool operator==(const arena_allocator &, const arena_allocator<U> &) noexcept { return true; }
+   template <typename U>
+   friend bool operator!=(const arena_allocator &, const arena_allocator<U> &) noexcept { return false; }
+};
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+template <typename K>
+using arena_set = std::set<K, std::less<K>, arena_allocator<K>>;
+
+template <typename K, typename V>
+using arena_map = std::map<K, V, std::less<K>, arena_allocator<std::pair<const K, V>>>;
+
+using arena_string = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
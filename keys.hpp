@@ -0,0 +1,162 @@
+#pragma once
+#include <eosiolib/eosio.hpp>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+   Binary storage of encryption keys
+   Keys come to actions as base64 text, optionally with PEM armor, and are stored decoded, so rows are at least a
+   third smaller. Key sizes are not fixed, so deployments pick their own RSA key size; stored keys begin with the
+   BINARY_FORMAT byte. Bytes have the same wire format as the strings they replaced, so rows written before keys were
+   stored binary load unchanged, with their text in place of the key, which never begins with that byte, until
+   migration converts them
+*/
+namespace keys
+{
+   /* First byte of every key stored binary, text can't begin with it */
+   static constexpr inline uint8_t BINARY_FORMAT = 0;
+   /* Bound of decoded keys, fits DER public keys and ciphertexts of RSA keys up to 8192 bits */
+   static constexpr inline size_t MAX_KEY_SIZE = 2048;
+
+   inline int base64_value(char c) noexcept
+   {
+      if (c >= 'A' && c <= 'Z')
+         return c - 'A';
+      if (c >= 'a' && c <= 'z')
+         return c - 'a' + 26;
+      if (c >= '0' && c <= '9')
+         return c - '0' + 52;
+      if (c == '+')
+         return 62;
+      if (c == '/')
+         return 63;
+      return -1;
+   }
+
+   /*
+      Decodes base64 text into out, skipping whitespace and PEM armor lines
+      Returns decoded length, or -1 if text is not base64 or is longer than capacity
+   */
+   inline int decode_text(std::string_view text, uint8_t *out, size_t capacity) noexcept
+   {
+      size_t length = 0;
+      uint32_t accumulator = 0;
+      int bits = 0;
+      auto padding = false;
+      for (size_t pos = 0; pos < text.size(); pos++)
+      {
+         const auto c = text[pos];
+         if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            continue;
+         /* Armor lines, e.g. -----BEGIN PUBLIC KEY-----, carry no key bytes */
+         if (c == '-')
+         {
+            while (pos < text.size() && text[pos] != '\n')
+               pos++;
+            continue;
+         }
+         if (c == '=')
+         {
+            padding = true;
+            continue;
+         }
+         const auto value = base64_value(c);
+         if (value < 0 || padding)
+            return -1;
+         accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+         bits += 6;
+         if (bits >= 8)
+         {
+            bits -= 8;
+            if (length == capacity)
+               return -1;
+            out[length++] = static_cast<uint8_t>(accumulator >> bits);
+         }
+      }
+      return static_cast<int>(length);
+   }
+
+   /* Keys stored binary, as opposed to text of rows written before */
+   inline bool is_binary(const std::vector<uint8_t> &stored) noexcept
+   {
+      return !stored.empty() && stored[0] == BINARY_FORMAT;
+   }
+
+   /* Encodes key stored binary back into the base64 text actions take, for forwarding to other shards */
+   inline std::string encode_text(const std::vector<uint8_t> &stored)
+   {
+      eosio_assert(is_binary(stored), "key is not stored binary");
+      static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      const auto key = stored.data() + 1;
+      const auto size = stored.size() - 1;
+      std::string text;
+      text.reserve((size + 2) / 3 * 4);
+      for (size_t pos = 0; pos < size; pos += 3)
+      {
+         uint32_t chunk = static_cast<uint32_t>(key[pos]) << 16;
+         if (pos + 1 < size)
+            chunk |= static_cast<uint32_t>(key[pos + 1]) << 8;
+         if (pos + 2 < size)
+            chunk |= key[pos + 2];
+         text += alphabet[chunk >> 18 & 63];
+         text += alphabet[chunk >> 12 & 63];
+         text += pos + 1 < size ? alphabet[chunk >> 6 & 63] : '=';
+         text += pos + 2 < size ? alphabet[chunk & 63] : '=';
+      }
+      return text;
+   }
+
+   /* Bytes which can appear in base64 or PEM text, binary keys are DER or ciphertext and practically never consist of them only */
+   inline bool is_text(std::string_view stored) noexcept
+   {
+      for (const auto c : stored)
+      {
+         if (base64_value(c) < 0 && c != '=' && c != '-' && c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            return false;
+      }
+      return !stored.empty();
+   }
+
+   /* Hex digits only, which are base64 too, but decode to other bytes than they encode */
+   inline bool is_hex(std::string_view stored) noexcept
+   {
+      return std::all_of(stored.begin(), stored.end(), [](const char c) {
+         return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+      });
+   }
+
+   /* Decodes key of any size up to MAX_KEY_SIZE given to an action, into its stored form */
+   inline std::vector<uint8_t> from_text(std::string_view text, const char *error)
+   {
+      /* Every 4 characters carry at most 3 bytes */
+      const auto capacity = std::min(text.size() / 4 * 3 + 3, MAX_KEY_SIZE);
+      std::vector<uint8_t> key(1 + capacity);
+      key[0] = BINARY_FORMAT;
+      const auto length = decode_text(text, key.data() + 1, capacity);
+      eosio_assert(length > 0, error);
+      key.resize(1 + length);
+      return key;
+   }
+
+   /*
+      Decodes key stored as text before keys were stored binary
+      Keys which are not base64 text, e.g. hex encoded or longer than MAX_KEY_SIZE, are left as they are, so that no
+      row becomes unreadable; returns whether key was converted
+   */
+   inline bool convert_stored(std::vector<uint8_t> &key)
+   {
+      const std::string_view stored{reinterpret_cast<const char *>(key.data()), key.size()};
+      if (is_binary(key) || !is_text(stored) || is_hex(stored))
+         return false;
+      std::vector<uint8_t> decoded(1 + MAX_KEY_SIZE);
+      decoded[0] = BINARY_FORMAT;
+      const auto length = decode_text(stored, decoded.data() + 1, MAX_KEY_SIZE);
+      if (length <= 0)
+         return false;
+      decoded.resize(1 + length);
+      key = std::move(decoded);
+      return true;
+   }
+} // namespace keys
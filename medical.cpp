@@ -1,7 +1,6 @@
 #include "medical.hpp"
 #include <eosiolib/transaction.hpp>
 #include <algorithm>
-#include <set>
 
 template <typename T>
 void remove(std::vector<T> &vec, size_t pos)
@@ -27,35 +26,74 @@ auto find(const std::vector<T> &vec, Validator &&validator)
    return index;
 }
 
-template <typename T, typename V>
-auto get_position_helper(const std::vector<T> &arr, const size_t lower, const size_t upper, const V &elem)
+/* Erases elements at ascending positions in a single pass */
+template <typename T, typename Positions>
+void remove_positions(std::vector<T> &vec, const Positions &positions)
 {
-   if (lower <= upper)
+   size_t next = 0;
+   size_t kept = 0;
+   for (size_t pos = 0; pos < vec.size(); pos++)
    {
-      const auto middle = lower + (upper - lower) / 2;
-      if (elem == arr[middle])
-         return middle;
-      if (elem < arr[middle])
+      if (next < positions.size() && positions[next] == pos)
       {
-         /* Sign overflow check */
-         if (middle != 0)
-         {
-            return get_position_helper(arr, lower, middle - 1, elem);
-         }
+         next++;
+         continue;
       }
+      if (kept != pos)
+         vec[kept] = std::move(vec[pos]);
+      kept++;
+   }
+   vec.resize(kept);
+}
+
+/*
+   Merges batch sorted by timestamp into ascending history with a single pass, history records come first among equal
+   timestamps; tracked positions of history records are replaced with their positions after merge
+*/
+template <typename Iter, typename Positions>
+void merge_records(std::vector<medical::recordetails> &history, Iter first, Iter last, Positions &tracked)
+{
+   std::vector<medical::recordetails> merged{};
+   merged.reserve(history.size() + std::distance(first, last));
+   size_t index = 0;
+   size_t next_tracked = 0;
+   const auto take_history = [&]() {
+      if (next_tracked < tracked.size() && tracked[next_tracked] == index)
+         tracked[next_tracked++] = merged.size();
+      merged.push_back(std::move(history[index++]));
+   };
+   const auto take_imported = [&]() {
+      merged.push_back({first->timestamp, std::move(first->hash), first->doctor, std::move(first->description)});
+      ++first;
+   };
+
+   while (index < history.size() && first != last)
+   {
+      if (history[index].timestamp <= first->timestamp)
+         take_history();
       else
-      {
-         return get_position_helper(arr, middle + 1, upper, elem);
-      }
+         take_imported();
    }
-   return lower;
+   while (index < history.size())
+      take_history();
+   while (first != last)
+      take_imported();
+   history = std::move(merged);
 }
 
-/* Returns the position of the elem or the index of the bucket where it was expected to be */
-template <typename T, typename V>
-auto get_position(const std::vector<T> &arr, const V &elem)
+/* Positions of tombstoned records of a specialty, in ascending order */
+arena_vector<uint32_t> tombstoned_records(const medical::tombstones &_tombstones, uint8_t specialtyid)
 {
-   return get_position_helper(arr, 0, arr.size() - 1, elem);
+   arena_vector<uint32_t> positions{};
+   for (auto tombstone_iter = _tombstones.lower_bound(medical::tombstone::make_id(specialtyid, 0));
+        tombstone_iter != _tombstones.end() && tombstone_iter->specialtyid() == specialtyid; ++tombstone_iter)
+      positions.push_back(tombstone_iter->position());
+   return positions;
+}
+
+bool is_tombstoned(const arena_vector<uint32_t> &tombstoned, size_t position)
+{
+   return std::binary_search(tombstoned.begin(), tombstoned.end(), position);
 }
 
 medical::medical(eosio::name receiver, eosio::name code, eosio::datastream<const char *> ds) : eosio::contract{receiver, code, ds},
@@ -146,6 +184,9 @@ void medical::fnshloadspcs()
 
 void medical::upsertpat(eosio::name patient, std::string &pubenckey)
 {
+   /* Key is stored decoded, text is only the transport of actions */
+   const auto public_key = keys::from_text(pubenckey, "public key must be base64 of a DER encoded key of at most 2048 bytes");
+
    /* Load patients table with patient scope */
    patients _patients{get_self(), patient.value};
    const auto patient_iter = _patients.find(patient.value);
@@ -154,15 +195,19 @@ void medical::upsertpat(eosio::name patient, std::string &pubenckey)
    {
       /* If not registered, register under contract authority */
       require_auth(get_self());
+      /* In sharded deployment patient is registered only on shard he was assigned to */
+      eosio_assert(is_local_patient(patient), "this patient belongs to another shard");
       /* Add to patients table */
       _patients.emplace(get_self(), [&](auto &_patient) {
          _patient.account = patient;
-         _patient.pubenckey = std::move(pubenckey);
+         _patient.pubenckey = public_key;
       });
       /* Add to records table */
       records{get_self(), patient.value}.emplace(get_self(), [&](auto &record) {
          record.patient = patient;
       });
+      /* Add to accounts registry */
+      register_account(patient, account::PATIENT);
    }
    else
    {
@@ -170,7 +215,7 @@ void medical::upsertpat(eosio::name patient, std::string &pubenckey)
       require_auth(patient);
       /* Update only public encryption key */
       _patients.modify(patient_iter, get_self(), [&](auto &_patient) {
-         _patient.pubenckey = std::move(pubenckey);
+         _patient.pubenckey = public_key;
       });
    }
 }
@@ -189,61 +234,158 @@ void medical::rmpatient(eosio::name patient)
    permissions _permissions{get_self(), patient.value};
    const auto &patient_perms = patient_iter->perms;
    for (const auto &[doctor, perm_ids] : patient_perms)
+   {
       for (const auto &perm_id : perm_ids)
          _permissions.erase(_permissions.find(perm_id));
 
-   /* Clear all patient records */
+      /* Remove patient from doctor's patients index */
+      docpatients _docpatients{get_self(), doctor.value};
+      if (const auto docpatient_iter = _docpatients.find(patient.value); docpatient_iter != _docpatients.end())
+         _docpatients.erase(docpatient_iter);
+   }
+   specperms _specperms{get_self(), patient.value};
+   for (auto specperm_iter = _specperms.begin(); specperm_iter != _specperms.end();)
+      specperm_iter = _specperms.erase(specperm_iter);
+
+   /* Clear all patient records, together with their entries in authoring doctors index */
    records _records{get_self(), patient.value};
-   _records.erase(_records.find(patient.value));
+   const auto patient_records_iter = _records.find(patient.value);
+   tombstones _tombstones{get_self(), patient.value};
+   for (const auto &[specialtyid, records] : patient_records_iter->details)
+   {
+      const auto tombstoned = tombstoned_records(_tombstones, specialtyid);
+      for (size_t index = 0; index < records.size(); index++)
+      {
+         if (!is_tombstoned(tombstoned, index))
+            unindex_authored_record(records[index].doctor, patient, specialtyid, records[index].timestamp, records[index].hash);
+      }
+   }
+   _records.erase(patient_records_iter);
+
+   /* Clear records summary */
+   summaries _summaries{get_self(), patient.value};
+   for (auto summary_iter = _summaries.begin(); summary_iter != _summaries.end();)
+      summary_iter = _summaries.erase(summary_iter);
+
+   /* Clear chart versions */
+   chartversions _chartversions{get_self(), patient.value};
+   for (auto version_iter = _chartversions.begin(); version_iter != _chartversions.end();)
+      version_iter = _chartversions.erase(version_iter);
+
+   /* Clear tombstones, their records were erased with the records row, and cancel pending compaction */
+   for (auto tombstone_iter = _tombstones.begin(); tombstone_iter != _tombstones.end();)
+      tombstone_iter = _tombstones.erase(tombstone_iter);
+   cancel_deferred(patient.value);
+
+   /* Clear access log together with its ring head */
+   accesses _accesses{get_self(), patient.value};
+   for (auto access_iter = _accesses.begin(); access_iter != _accesses.end();)
+      access_iter = _accesses.erase(access_iter);
+   ringheads _ringheads{get_self(), patient.value};
+   if (const auto head_iter = _ringheads.find(eosio::name{"accesses"}.value); head_iter != _ringheads.end())
+      _ringheads.erase(head_iter);
 
    /* Finally remove patient from patients table */
    _patients.erase(patient_iter);
+   unregister_account(patient, account::PATIENT);
 }
 
 void medical::upsertdoc(eosio::name doctor, uint8_t specialtyid, std::string &pubenckey)
 {
+   /* Mirror doctor on the other shards, failing checks below revert forwarding too */
+   const auto forwarded = is_forwarded_by_shard();
+   if (!forwarded)
+      forward_to_shards(eosio::name{"upsertdoc"}, std::make_tuple(doctor, specialtyid, pubenckey));
+   const auto public_key = keys::from_text(pubenckey, "public key must be base64 of a DER encoded key of at most 2048 bytes");
+
    /* Get doctor table */
    doctors _doctors{get_self(), doctor.value};
    const auto doctor_iter = _doctors.find(doctor.value);
 
    if (doctor_iter == _doctors.end())
    {
-      /* Check signature of medical contract */
-      require_auth(get_self());
+      /* Check signature of medical contract, forwarded actions were checked by originating shard */
+      if (!forwarded)
+         require_auth(get_self());
       /* Check specialty id validity */
       const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
       eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+      /* Group names are used in place of doctor accounts, so they must not collide */
+      eosio_assert(!is_group(doctor), "this name belongs to a group");
       /* Emplace new doctor */
       _doctors.emplace(get_self(), [&](auto &_doctor) {
          _doctor.account = doctor;
          _doctor.specialtyid = specialtyid;
-         _doctor.pubenckey = std::move(pubenckey);
+         _doctor.pubenckey = public_key;
       });
+      /* Add to accounts registry */
+      register_account(doctor, account::DOCTOR);
    }
    else
    {
       /* Check signature of doctor */
-      require_auth(doctor);
+      if (!forwarded)
+         require_auth(doctor);
       /* Modify existing doctor */
       _doctors.modify(doctor_iter, get_self(), [&](auto &_doctor) {
          _doctor.specialtyid = specialtyid;
-         _doctor.pubenckey = std::move(pubenckey);
+         _doctor.pubenckey = public_key;
       });
    }
 }
 
 void medical::rmdoctor(eosio::name doctor)
 {
-   /* Check signature of medical contract */
-   require_auth(get_self());
+   /* Check signature of medical contract, forwarded actions were checked by originating shard */
+   const auto forwarded = is_forwarded_by_shard();
+   if (!forwarded)
+   {
+      require_auth(get_self());
+      forward_to_shards(eosio::name{"rmdoctor"}, std::make_tuple(doctor));
+   }
 
-   /* Try find existing doctor */
+   /* Try find existing doctor, doctors which were never mirrored to this shard have nothing to remove */
    doctors _doctors{get_self(), doctor.value};
    const auto doctor_iter = _doctors.find(doctor.value);
+   if (forwarded && doctor_iter == _doctors.end())
+      return;
    eosio_assert(doctor_iter != _doctors.end(), "this doctor wan't registered before");
 
    /* Remove existing doctor */
    _doctors.erase(doctor_iter);
+   unregister_account(doctor, account::DOCTOR);
+
+   /* Revoke grants to doctor, its patients index lists every patient of this shard which granted it something */
+   docpatients _docpatients{get_self(), doctor.value};
+   for (auto docpatient_iter = _docpatients.begin(); docpatient_iter != _docpatients.end();)
+   {
+      revoke_grantee(docpatient_iter->patient, doctor);
+      docpatient_iter = _docpatients.erase(docpatient_iter);
+   }
+
+   /* Leave all groups doctor was member of */
+   groups _groups{get_self(), get_self().value};
+   memberships _memberships{get_self(), doctor.value};
+   for (auto membership_iter = _memberships.begin(); membership_iter != _memberships.end();)
+   {
+      const auto group_iter = _groups.find(membership_iter->group.value);
+      const auto index = find(group_iter->members, [doctor](const auto member) { return member == doctor; });
+      if (index != -1)
+      {
+         _groups.modify(group_iter, get_self(), [index](auto &group) {
+            remove(group.members, index);
+         });
+      }
+      membership_iter = _memberships.erase(membership_iter);
+   }
+
+   /* Clear records feed together with its ring head */
+   inbox _inbox{get_self(), doctor.value};
+   for (auto inbox_iter = _inbox.begin(); inbox_iter != _inbox.end();)
+      inbox_iter = _inbox.erase(inbox_iter);
+   ringheads _ringheads{get_self(), doctor.value};
+   if (const auto head_iter = _ringheads.find(eosio::name{"inbox"}.value); head_iter != _ringheads.end())
+      _ringheads.erase(head_iter);
 }
 
 void medical::schedule_for_deletion(const perm_info &perm, uint64_t permid, uint32_t current_time, uint32_t upper_interval)
@@ -258,6 +400,347 @@ void medical::schedule_for_deletion(const perm_info &perm, uint64_t permid, uint
    t.send(permid, perm.patient);
 }
 
+eosio::name medical::patient_shard(eosio::name patient)
+{
+   shardconfigs _shardconfigs{get_self(), get_self().value};
+   const auto config_iter = _shardconfigs.find(shardconfig::SINGLETON_ID);
+   if (config_iter == _shardconfigs.end())
+      return get_self();
+   const auto &shards = config_iter->shards;
+   return shards[sharding::shard_of(patient.value, shards.size())];
+}
+
+bool medical::is_local_patient(eosio::name patient)
+{
+   return patient_shard(patient) == get_self();
+}
+
+bool medical::is_forwarded_by_shard()
+{
+   /* Actions forwarded by another shard carry its authority instead of the original signatures */
+   shardconfigs _shardconfigs{get_self(), get_self().value};
+   const auto config_iter = _shardconfigs.find(shardconfig::SINGLETON_ID);
+   if (config_iter == _shardconfigs.end())
+      return false;
+   return std::any_of(config_iter->shards.begin(), config_iter->shards.end(), [this](const auto shard) {
+      return shard != get_self() && has_auth(shard);
+   });
+}
+
+template <typename... Args>
+void medical::forward_to_shards(eosio::name action, const std::tuple<Args...> &args)
+{
+   /*
+      Forwarded actions carry active authority of this shard, so every shard account must include its own eosio.code
+      permission, e.g. medshard1@eosio.code on medshard1@active
+   */
+   shardconfigs _shardconfigs{get_self(), get_self().value};
+   const auto config_iter = _shardconfigs.find(shardconfig::SINGLETON_ID);
+   if (config_iter == _shardconfigs.end())
+      return;
+   for (const auto shard : config_iter->shards)
+   {
+      if (shard != get_self())
+         eosio::action(eosio::permission_level(get_self(), eosio::name{"active"}), shard, action, args).send();
+   }
+}
+
+bool medical::is_group(eosio::name grantee)
+{
+   groups _groups{get_self(), get_self().value};
+   return _groups.find(grantee.value) != _groups.end();
+}
+
+arena_vector<eosio::name> medical::doctor_groups(eosio::name doctor)
+{
+   /* Groups are resolved through doctor memberships index */
+   arena_vector<eosio::name> groups{};
+   memberships _memberships{get_self(), doctor.value};
+   for (const auto &membership : _memberships)
+      groups.push_back(membership.group);
+   return groups;
+}
+
+template <typename Visitor>
+bool medical::for_each_doctor_perms(const perm_info &perm, const std::map<eosio::name, std::vector<uint64_t>> &patient_perms,
+                                    const arena_vector<eosio::name> &doctor_groups, Visitor &&visitor)
+{
+   /* Visits permissions granted to doctor directly, then through his groups, until visitor is satisfied */
+   auto hasAnyPermission = false;
+   if (const auto doctor_perms_iter = patient_perms.find(perm.doctor); doctor_perms_iter != patient_perms.end())
+   {
+      hasAnyPermission = true;
+      if (visitor(doctor_perms_iter->second))
+         return hasAnyPermission;
+   }
+
+   for (const auto group : doctor_groups)
+   {
+      if (const auto group_perms_iter = patient_perms.find(group); group_perms_iter != patient_perms.end())
+      {
+         hasAnyPermission = true;
+         if (visitor(group_perms_iter->second))
+            break;
+      }
+   }
+   return hasAnyPermission;
+}
+
+void medical::upsertgroup(eosio::name group, eosio::name institution, std::string &pubenckey)
+{
+   /* Mirror group on the other shards, failing checks below revert forwarding too */
+   const auto forwarded = is_forwarded_by_shard();
+   if (!forwarded)
+      forward_to_shards(eosio::name{"upsertgroup"}, std::make_tuple(group, institution, pubenckey));
+   const auto public_key = keys::from_text(pubenckey, "public key must be base64 of a DER encoded key of at most 2048 bytes");
+
+   /* Load groups table */
+   groups _groups{get_self(), get_self().value};
+   const auto group_iter = _groups.find(group.value);
+
+   if (group_iter == _groups.end())
+   {
+      /* If not registered, register under contract authority, forwarded actions were checked by originating shard */
+      if (!forwarded)
+         require_auth(get_self());
+      /* Institution account check */
+      eosio_assert(is_account(institution), "institution account does not exist");
+      /* Group name is used in place of doctor account, so they must not collide */
+      doctors _doctors{get_self(), group.value};
+      eosio_assert(_doctors.find(group.value) == _doctors.end(), "this name belongs to a doctor");
+      /* Emplace new group */
+      _groups.emplace(get_self(), [&](auto &_group) {
+         _group.id = group;
+         _group.institution = institution;
+         _group.pubenckey = public_key;
+      });
+      /* Add to accounts registry, so that migrations reach group rows too */
+      register_account(group, account::GROUP);
+   }
+   else
+   {
+      /* If already registered, update under institution authority */
+      if (!forwarded)
+         require_auth(group_iter->institution);
+      /* Institution account check */
+      eosio_assert(is_account(institution), "institution account does not exist");
+      /* Modify existing group */
+      _groups.modify(group_iter, get_self(), [&](auto &_group) {
+         _group.institution = institution;
+         _group.pubenckey = public_key;
+      });
+   }
+}
+
+void medical::rmgroup(eosio::name group)
+{
+   /* Check signature of medical contract, forwarded actions were checked by originating shard */
+   const auto forwarded = is_forwarded_by_shard();
+   if (!forwarded)
+   {
+      require_auth(get_self());
+      forward_to_shards(eosio::name{"rmgroup"}, std::make_tuple(group));
+   }
+
+   /* Try find existing group, groups which were never mirrored to this shard have nothing to remove */
+   groups _groups{get_self(), get_self().value};
+   const auto group_iter = _groups.find(group.value);
+   if (forwarded && group_iter == _groups.end())
+      return;
+   eosio_assert(group_iter != _groups.end(), "this group wasn't registered before");
+
+   /* Clear memberships of all members */
+   for (const auto member : group_iter->members)
+   {
+      memberships _memberships{get_self(), member.value};
+      _memberships.erase(_memberships.find(group.value));
+   }
+
+   /* Revoke grants to group, its keys list every patient of this shard which granted it something */
+   groupkeys _groupkeys{get_self(), group.value};
+   for (auto groupkey_iter = _groupkeys.begin(); groupkey_iter != _groupkeys.end();)
+   {
+      revoke_grantee(groupkey_iter->patient, group);
+      groupkey_iter = _groupkeys.erase(groupkey_iter);
+   }
+   docpatients _docpatients{get_self(), group.value};
+   for (auto docpatient_iter = _docpatients.begin(); docpatient_iter != _docpatients.end();)
+      docpatient_iter = _docpatients.erase(docpatient_iter);
+
+   /* Remove existing group */
+   _groups.erase(group_iter);
+   unregister_account(group, account::GROUP);
+}
+
+void medical::revoke_grantee(eosio::name patient, eosio::name grantee)
+{
+   patients _patients{get_self(), patient.value};
+   const auto patient_iter = _patients.find(patient.value);
+   if (patient_iter == _patients.end())
+      return;
+   const auto grantee_perms_iter = patient_iter->perms.find(grantee);
+   if (grantee_perms_iter == patient_iter->perms.end())
+      return;
+
+   /* Erase permissions together with their specialties index and pending auto-deletions */
+   permissions _permissions{get_self(), patient.value};
+   for (const auto permid : grantee_perms_iter->second)
+   {
+      const auto permission_iter = _permissions.find(permid);
+      if (permission_iter == _permissions.end())
+         continue;
+      if (permission_iter->right == right::WRITE && permission_iter->interval.is_limited())
+      {
+         cancel_deferred(permid);
+      }
+      unindex_permission(patient, permid, permission_iter->specialtyids);
+      _permissions.erase(permission_iter);
+   }
+
+   /* Patient didn't authorize this, so row stays paid by whoever paid it */
+   _patients.modify(patient_iter, eosio::same_payer, [grantee](auto &_patient) {
+      _patient.perms.erase(grantee);
+   });
+}
+
+void medical::addmember(eosio::name group, eosio::name doctor)
+{
+   /* Group existence check */
+   groups _groups{get_self(), get_self().value};
+   const auto group_iter = _groups.find(group.value);
+   eosio_assert(group_iter != _groups.end(), "this group wasn't registered before");
+
+   /* Membership is managed only by institution, forwarded actions were checked by originating shard */
+   const auto forwarded = is_forwarded_by_shard();
+   if (!forwarded)
+   {
+      require_auth(group_iter->institution);
+      forward_to_shards(eosio::name{"addmember"}, std::make_tuple(group, doctor));
+   }
+   /* Mirrors are paid by shard, as institution didn't authorize forwarded action */
+   const auto payer = forwarded ? get_self() : group_iter->institution;
+
+   /* Check if specified doctor is medic for real */
+   doctors _doctors{get_self(), doctor.value};
+   eosio_assert(_doctors.find(doctor.value) != _doctors.end(), "this doctor wan't registered before");
+
+   /* Membership uniqueness check, mirror forwards memberships which other shards may already have */
+   memberships _memberships{get_self(), doctor.value};
+   if (_memberships.find(group.value) != _memberships.end())
+   {
+      eosio_assert(forwarded, "this doctor is already a member of this group");
+      return;
+   }
+
+   /* Add doctor to group and group to doctor memberships */
+   _groups.modify(group_iter, payer, [doctor](auto &_group) {
+      _group.members.push_back(doctor);
+   });
+   _memberships.emplace(payer, [group](auto &membership) {
+      membership.group = group;
+   });
+}
+
+void medical::rmmember(eosio::name group, eosio::name doctor)
+{
+   /* Group existence check, groups which were never mirrored to this shard have no members to remove */
+   groups _groups{get_self(), get_self().value};
+   const auto group_iter = _groups.find(group.value);
+   const auto forwarded = is_forwarded_by_shard();
+   if (forwarded && group_iter == _groups.end())
+      return;
+   eosio_assert(group_iter != _groups.end(), "this group wasn't registered before");
+
+   /* Membership is managed only by institution, forwarded actions were checked by originating shard */
+   if (!forwarded)
+   {
+      require_auth(group_iter->institution);
+      forward_to_shards(eosio::name{"rmmember"}, std::make_tuple(group, doctor));
+   }
+   /* Mirrors are paid by shard, as institution didn't authorize forwarded action */
+   const auto payer = forwarded ? get_self() : group_iter->institution;
+
+   /* Membership existence check, likewise tolerating memberships which were never mirrored */
+   const auto index = find(group_iter->members, [doctor](const auto member) { return member == doctor; });
+   if (forwarded && index == -1)
+      return;
+   eosio_assert(index != -1, "this doctor is not a member of this group");
+
+   /* Remove doctor from group and group from doctor memberships */
+   _groups.modify(group_iter, payer, [index](auto &_group) {
+      remove(_group.members, index);
+   });
+   memberships _memberships{get_self(), doctor.value};
+   _memberships.erase(_memberships.find(group.value));
+}
+
+void medical::update_doctor_patients(const perm_info &perm, const std::map<eosio::name, std::vector<uint64_t>> &patient_perms,
+                                     const permissions &_permissions, uint32_t current_time)
+{
+   docpatients _docpatients{get_self(), perm.doctor.value};
+   const auto docpatient_iter = _docpatients.find(perm.patient.value);
+
+   /* Patient no longer grants anything to this doctor */
+   const auto doctor_perms_iter = patient_perms.find(perm.doctor);
+   if (doctor_perms_iter == patient_perms.end() || doctor_perms_iter->second.empty())
+   {
+      if (docpatient_iter != _docpatients.end())
+         _docpatients.erase(docpatient_iter);
+      return;
+   }
+
+   /* Summarize doctor permissions */
+   uint8_t right_bits = 0;
+   uint32_t next_expiry = 0;
+   for (const auto permid : doctor_perms_iter->second)
+   {
+      const auto &permission = *_permissions.find(permid);
+      right_bits |= access::bits_of(permission.right);
+      /* Closest upper bound which is not in the past */
+      if (permission.interval.is_limited() && permission.interval.to >= current_time &&
+          (next_expiry == 0 || permission.interval.to < next_expiry))
+         next_expiry = permission.interval.to;
+   }
+
+   const auto updater = [&](auto &docpatient) {
+      docpatient.patient = perm.patient;
+      /* Union of rights maps back to right id by the same offset */
+      docpatient.right = right_bits - 1;
+      docpatient.nextexpiry = next_expiry;
+   };
+
+   if (docpatient_iter == _docpatients.end())
+      _docpatients.emplace(perm.patient, updater);
+   else
+      _docpatients.modify(docpatient_iter, perm.patient, updater);
+}
+
+std::pair<uint8_t, uint32_t> medical::live_grants(const perm_info &perm, uint32_t current_time)
+{
+   patients _patients{get_self(), perm.patient.value};
+   const auto patient_iter = _patients.find(perm.patient.value);
+   if (patient_iter == _patients.end())
+      return {0, 0};
+   const auto doctor_perms_iter = patient_iter->perms.find(perm.doctor);
+   if (doctor_perms_iter == patient_iter->perms.end())
+      return {0, 0};
+
+   /* Same summary as update_doctor_patients, without permissions whose interval already ended */
+   permissions _permissions{get_self(), perm.patient.value};
+   uint8_t right_bits = 0;
+   uint32_t next_expiry = 0;
+   for (const auto permid : doctor_perms_iter->second)
+   {
+      const auto &permission = *_permissions.find(permid);
+      if (permission.interval.is_limited() && permission.interval.to < current_time)
+         continue;
+      right_bits |= access::bits_of(permission.right);
+      if (permission.interval.is_limited() && (next_expiry == 0 || permission.interval.to < next_expiry))
+         next_expiry = permission.interval.to;
+   }
+   return {right_bits, next_expiry};
+}
+
 bool medical::specialty::are_overlapped(const std::vector<uint8_t> &_specialtyids, const std::vector<uint8_t> &_otherspecialtyids) noexcept
 {
    for (const auto &_firstspecid : _specialtyids)
@@ -269,7 +752,7 @@ bool medical::specialty::are_overlapped(const std::vector<uint8_t> &_specialtyid
 
 bool medical::specialty::are_specialties_unique(const std::vector<uint8_t> &_specialtyids) noexcept
 {
-   return std::set<uint8_t>{_specialtyids.begin(), _specialtyids.end()}.size() == _specialtyids.size();
+   return arena_set<uint8_t>{_specialtyids.begin(), _specialtyids.end()}.size() == _specialtyids.size();
 }
 
 bool medical::permission::are_overlapped(const std::vector<uint8_t> &__specialtyids, uint8_t __right, const medical::interval &__interval, const permission &__other_perm) noexcept
@@ -285,14 +768,8 @@ bool medical::permission::are_overlapped(const std::vector<uint8_t> &__specialty
    return false;
 }
 
-void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval, std::string &decreckey)
+void medical::check_permission_request(const std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval, uint32_t current_time)
 {
-   /* Signature check */
-   require_auth(perm.patient);
-
-   /* Doctor account check */
-   eosio_assert(is_account(perm.doctor), "doctor account does not exist");
-
    /* Right id validity check */
    eosio_assert(right::isRightInValidRange(rightid), "invalid right range. valid ones are: CONSULT=0 ADD=1 CONSULT & ADD=2");
 
@@ -300,29 +777,21 @@ void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids,
    eosio_assert(interval.is_valid(), "specified interval is not valid");
 
    /* Interval duration check */
-   const auto curr_time = now();
-   const auto isLimitedInterval = interval.is_limited();
-   if (isLimitedInterval)
+   const auto has_write = access::has_write(rightid);
+   if (interval.is_limited())
    {
       /* Check for write and read&write permissions to not start before current time */
-      if (rightid == right::WRITE || rightid == right::READ_WRITE)
+      eosio_assert(!has_write || interval.from >= current_time, "interval can't start before current time");
+      /* Every permission must respect minimum interval */
+      if (!interval.has_min_duration())
       {
-         const auto isGreatherOrEqThanCurrentTime = interval.from >= curr_time;
-         eosio_assert(isGreatherOrEqThanCurrentTime, "interval can't start before current time");
+         eosio_assert(false, (arena_string{"min interval is "} + interval.MIN_INTERVAL_STR + " or infinite").c_str());
       }
-      /* Every permission must respect minimum interval */
-      eosio_assert(interval.has_min_duration(), (std::string("min interval is ") + interval.MIN_INTERVAL_STR + " or infinite").c_str());
    }
 
    /* Specialties cardinality check */
-   if ((rightid == right::WRITE || rightid == right::READ_WRITE) && (specialtyids.size() != 1))
-   {
-      eosio_assert(false, "ADD or CONSULT&ADD rights can contain only 1 specialty");
-   }
-   if ((rightid == right::READ) && (specialtyids.empty()))
-   {
-      eosio_assert(false, "CONSULT right must contain at least 1 specialty");
-   }
+   eosio_assert(!has_write || specialtyids.size() == 1, "ADD or CONSULT&ADD rights can contain only 1 specialty");
+   eosio_assert(has_write || !specialtyids.empty(), "CONSULT right must contain at least 1 specialty");
 
    /* Unique specialty ids check */
    eosio_assert(specialty::are_specialties_unique(specialtyids), "all specialties must be unique");
@@ -333,6 +802,21 @@ void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids,
    {
       eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
    }
+}
+
+void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval, std::string &decreckey)
+{
+   /* Signature check */
+   require_auth(perm.patient);
+
+   /* Doctor account check, grantee can also be a group of doctors */
+   const auto grantee_is_group = is_group(perm.doctor);
+   eosio_assert(grantee_is_group || is_account(perm.doctor), "doctor account does not exist");
+
+   /* Right, interval and specialties validity check */
+   const auto curr_time = now();
+   const auto isLimitedInterval = interval.is_limited();
+   check_permission_request(specialtyids, rightid, interval, curr_time);
 
    /* Patient registration check */
    patients _patients{get_self(), perm.patient.value};
@@ -342,10 +826,10 @@ void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids,
    /* Check if specified doctor is medic for real */
    doctors _doctors{get_self(), perm.doctor.value};
    const auto doctor_iter = _doctors.find(perm.doctor.value);
-   eosio_assert(doctor_iter != _doctors.end(), "this doctor wan't registered before");
+   eosio_assert(grantee_is_group || doctor_iter != _doctors.end(), "this doctor wan't registered before");
 
-   /* Check medic specialty for WRITE and READ & WRITE rights */
-   if (rightid == right::WRITE || rightid == right::READ_WRITE)
+   /* Check medic specialty for WRITE and READ & WRITE rights, group members are checked when writing records */
+   if (!grantee_is_group && (rightid == right::WRITE || rightid == right::READ_WRITE))
    {
       eosio_assert(doctor_iter->specialtyid == specialtyids[0], "this doctor doesn't belongs to specified speciality");
    }
@@ -364,24 +848,38 @@ void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids,
 
    /* Granted record encription AES key from patient section*/
    /* This key is needed only when adding first perm */
-   auto &doctor_granted_keys = doctor_iter->grantedkeys;
-   const auto &patient_granted_key_iter = doctor_granted_keys.find(perm.patient);
+   groupkeys _groupkeys{get_self(), perm.doctor.value};
+   const auto is_first_permission = grantee_is_group ? _groupkeys.find(perm.patient.value) == _groupkeys.end()
+                                                     : doctor_iter->grantedkeys.find(perm.patient) == doctor_iter->grantedkeys.end();
    /* Is this first permission adding ? */
-   if (patient_granted_key_iter == doctor_granted_keys.end())
+   if (is_first_permission)
    {
       /* Check for key validity */
       if (decreckey.empty())
       {
          eosio_assert(false, "when adding perm for first time, you must provide your record encription/decryption key");
       }
-      /* Add key to granted set from patient to specified doctor */
-      _doctors.modify(doctor_iter, perm.patient, [&perm, &decreckey](auto &doctor) {
-         doctor.grantedkeys[perm.patient] = std::move(decreckey);
-      });
+      const auto record_key = keys::from_text(decreckey, "record key must be base64 of an encrypted key of at most 2048 bytes");
+      if (grantee_is_group)
+      {
+         /* Add key encrypted with group key to granted keys of specified group */
+         _groupkeys.emplace(perm.patient, [&perm, &record_key](auto &groupkey) {
+            groupkey.patient = perm.patient;
+            groupkey.key = record_key;
+         });
+      }
+      else
+      {
+         /* Add key to granted set from patient to specified doctor */
+         _doctors.modify(doctor_iter, perm.patient, [&perm, &record_key](auto &doctor) {
+            doctor.grantedkeys[perm.patient] = record_key;
+         });
+      }
    }
 
    /* Permission emplacement */
    const auto perm_id = _permissions.available_primary_key();
+   index_permission(perm.patient, perm.doctor, perm_id, specialtyids, perm.patient);
    _permissions.emplace(perm.patient, [&](auto &perm) {
       perm.id = perm_id;
       perm.specialtyids = std::move(specialtyids);
@@ -394,6 +892,9 @@ void medical::addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids,
       patient.perms[perm.doctor].push_back(perm_id);
    });
 
+   /* Reflect new permission in doctor's patients index */
+   update_doctor_patients(perm, patient_iter->perms, _permissions, curr_time);
+
    /* Schedule for auto-deletion write permissions only if they are not unlimited */
    if (rightid == right::WRITE && isLimitedInterval)
    {
@@ -406,48 +907,13 @@ void medical::updtperm(const perm_info &perm, uint64_t permid, std::vector<uint8
    /* Signature check */
    require_auth(perm.patient);
 
-   /* Doctor account check */
-   eosio_assert(is_account(perm.doctor), "doctor account does not exist");
-
-   /* Right id validity check */
-   eosio_assert(right::isRightInValidRange(rightid), "invalid right range. valid ones are: CONSULT=0 ADD=1 CONSULT & ADD=2");
-
-   /* Interval validity check */
-   eosio_assert(interval.is_valid(), "specified interval is not valid");
+   /* Doctor account check, grantee can also be a group of doctors */
+   const auto grantee_is_group = is_group(perm.doctor);
+   eosio_assert(grantee_is_group || is_account(perm.doctor), "doctor account does not exist");
 
-   /* Interval duration check */
+   /* Right, interval and specialties validity check */
    const auto curr_time = now();
-   if (interval.is_limited())
-   {
-      /* Check for write and read&write permissions to not start before current time */
-      if (rightid == right::WRITE || rightid == right::READ_WRITE)
-      {
-         const auto isGreatherOrEqThanCurrentTime = interval.from >= curr_time;
-         eosio_assert(isGreatherOrEqThanCurrentTime, "interval can't start before current time");
-      }
-      /* Every permission must respect minimum interval */
-      eosio_assert(interval.has_min_duration(), (std::string("min interval is ") + interval.MIN_INTERVAL_STR + " or infinite").c_str());
-   }
-
-   /* Specialties cardinality check */
-   if ((rightid == right::WRITE || rightid == right::READ_WRITE) && (specialtyids.size() != 1))
-   {
-      eosio_assert(false, "ADD or CONSULT&ADD rights can contain only 1 specialty");
-   }
-   if ((rightid == right::READ) && (specialtyids.empty()))
-   {
-      eosio_assert(false, "CONSULT right must contain at least 1 specialty");
-   }
-
-   /* Unique specialty ids check */
-   eosio_assert(specialty::are_specialties_unique(specialtyids), "all specialties must be unique");
-
-   /* Specialty ids validity check */
-   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
-   for (const auto specialtyid : specialtyids)
-   {
-      eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
-   }
+   check_permission_request(specialtyids, rightid, interval, curr_time);
 
    /* Patient registration check */
    patients _patients{get_self(), perm.patient.value};
@@ -457,7 +923,7 @@ void medical::updtperm(const perm_info &perm, uint64_t permid, std::vector<uint8
    /* Check if specified doctor is medic for real */
    doctors _doctors{get_self(), perm.doctor.value};
    const auto doctor_iter = _doctors.find(perm.doctor.value);
-   eosio_assert(doctor_iter != _doctors.end(), "this doctor wan't registered before");
+   eosio_assert(grantee_is_group || doctor_iter != _doctors.end(), "this doctor wan't registered before");
 
    /* Doctor permissions check */
    const auto &patient_perms = patient_iter->perms;
@@ -476,8 +942,8 @@ void medical::updtperm(const perm_info &perm, uint64_t permid, std::vector<uint8
    const auto permission_iter = _permissions.find(permid);
    eosio_assert(permission_iter != _permissions.end(), "this permission id is not valid");
 
-   /* Check medic specialty for WRITE and READ & WRITE rights */
-   if (rightid == right::WRITE || rightid == right::READ_WRITE)
+   /* Check medic specialty for WRITE and READ & WRITE rights, group members are checked when writing records */
+   if (!grantee_is_group && (rightid == right::WRITE || rightid == right::READ_WRITE))
    {
       eosio_assert(doctor_iter->specialtyid == specialtyids[0], "this doctor doesn't belongs to specified speciality");
    }
@@ -524,12 +990,17 @@ void medical::updtperm(const perm_info &perm, uint64_t permid, std::vector<uint8
       schedule_for_deletion(perm, permid, curr_time, interval.to);
    }
 
-   /* Update permission */
+   /* Update permission, together with its specialties index */
+   unindex_permission(perm.patient, permid, permission_iter->specialtyids);
+   index_permission(perm.patient, perm.doctor, permid, specialtyids, perm.patient);
    _permissions.modify(permission_iter, perm.patient, [&](auto &perm) {
       perm.specialtyids = std::move(specialtyids);
       perm.right = rightid;
       perm.interval = interval;
    });
+
+   /* Reflect updated permission in doctor's patients index */
+   update_doctor_patients(perm, patient_perms, _permissions, curr_time);
 }
 
 void medical::rmperm(const perm_info &perm, uint64_t permid)
@@ -537,8 +1008,9 @@ void medical::rmperm(const perm_info &perm, uint64_t permid)
    /* Signature check */
    require_auth(perm.patient);
 
-   /* Doctor account check */
-   eosio_assert(is_account(perm.doctor), "doctor account does not exist");
+   /* Doctor account check, grantee can also be a group of doctors */
+   const auto grantee_is_group = is_group(perm.doctor);
+   eosio_assert(grantee_is_group || is_account(perm.doctor), "doctor account does not exist");
 
    /* Patient registration check */
    patients _patients{get_self(), perm.patient.value};
@@ -570,7 +1042,8 @@ void medical::rmperm(const perm_info &perm, uint64_t permid)
       cancel_deferred(permission_iter->id);
    }
 
-   /* Erase perm from permissions table */
+   /* Erase perm from permissions table and its specialties index */
+   unindex_permission(perm.patient, permid, permission_iter->specialtyids);
    _permissions.erase(permission_iter);
 
    /* Update doctor permissions for this patient */
@@ -580,11 +1053,19 @@ void medical::rmperm(const perm_info &perm, uint64_t permid)
       {
          /* First, erase doctor from map */
          patient.perms.erase(perm.doctor);
-         /* Second, erase granted enc/dec record key from doctor*/
-         doctors _doctors{get_self(), perm.doctor.value};
-         _doctors.modify(_doctors.find(perm.doctor.value), perm.patient, [&perm](auto &doctor) {
-            doctor.grantedkeys.erase(perm.patient);
-         });
+         /* Second, erase granted enc/dec record key from doctor or group */
+         if (grantee_is_group)
+         {
+            groupkeys _groupkeys{get_self(), perm.doctor.value};
+            _groupkeys.erase(_groupkeys.find(perm.patient.value));
+         }
+         else
+         {
+            doctors _doctors{get_self(), perm.doctor.value};
+            _doctors.modify(_doctors.find(perm.doctor.value), perm.patient, [&perm](auto &doctor) {
+               doctor.grantedkeys.erase(perm.patient);
+            });
+         }
       }
       else
       {
@@ -592,23 +1073,212 @@ void medical::rmperm(const perm_info &perm, uint64_t permid)
          remove(patient.perms[perm.doctor], index);
       }
    });
+
+   /* Reflect removed permission in doctor's patients index */
+   update_doctor_patients(perm, patient_iter->perms, _permissions, now());
 }
 
-void medical::writerecord(const perm_info &perm, uint8_t specialtyid, record_info &recordinfo)
+void medical::revokespec(eosio::name patient, uint8_t specialtyid)
 {
-   /* Signatures check */
-   require_auth(perm.doctor);
-
-   /* Specialty id validity check */
-   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
-   eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+   /* Signature check */
+   require_auth(patient);
 
    /* Patient registration check */
-   patients _patients{get_self(), perm.patient.value};
-   const auto &patient_iter = _patients.find(perm.patient.value);
-   eosio_assert(patient_iter != _patients.end(), "this patient wasn't registered");
+   patients _patients{get_self(), patient.value};
+   const auto patient_iter = _patients.find(patient.value);
+   eosio_assert(patient_iter != _patients.end(), "you are not registered yet");
 
-   /* Load patient records table */
+   /* Index is complete only after patient was migrated, until then missing entries are added here */
+   if (account_version(patient) < schema::PERMISSIONS_VERSION)
+      index_patient_permissions(patient, patient);
+
+   /* Narrow or erase every permission granting specialty, index entries are consumed while walking them */
+   permissions _permissions{get_self(), patient.value};
+   specperms _specperms{get_self(), patient.value};
+   arena_map<eosio::name, arena_vector<uint64_t>> removed_permids;
+   arena_set<eosio::name> grantees;
+   for (auto specperm_iter = _specperms.lower_bound(specperm::make_id(specialtyid, 0));
+        specperm_iter != _specperms.end() && specperm_iter->specialtyid() == specialtyid;)
+   {
+      const auto permission_iter = _permissions.find(specperm_iter->permid());
+      grantees.insert(specperm_iter->grantee);
+      if (permission_iter->specialtyids.size() == 1)
+      {
+         /* Nothing else is granted, so permission is erased together with its pending auto-deletion */
+         if (permission_iter->right == right::WRITE && permission_iter->interval.is_limited())
+         {
+            cancel_deferred(permission_iter->id);
+         }
+         removed_permids[specperm_iter->grantee].push_back(permission_iter->id);
+         _permissions.erase(permission_iter);
+      }
+      else
+      {
+         /* Only READ permissions span several specialties, they keep granting the other ones */
+         _permissions.modify(permission_iter, patient, [specialtyid](auto &permission) {
+            remove(permission.specialtyids, find(permission.specialtyids, [specialtyid](const auto id) { return id == specialtyid; }));
+         });
+      }
+      specperm_iter = _specperms.erase(specperm_iter);
+   }
+   eosio_assert(!grantees.empty(), "no permission grants this specialty");
+
+   /* Patient permissions are rewritten once for all erased permissions */
+   arena_vector<eosio::name> released_grantees;
+   if (!removed_permids.empty())
+   {
+      _patients.modify(patient_iter, patient, [&](auto &_patient) {
+         for (const auto &[grantee, permids] : removed_permids)
+         {
+            auto &grantee_perms = _patient.perms[grantee];
+            grantee_perms.erase(std::remove_if(grantee_perms.begin(), grantee_perms.end(), [&permids](const auto permid) {
+                                   return std::find(permids.begin(), permids.end(), permid) != permids.end();
+                                }),
+                                grantee_perms.end());
+            if (grantee_perms.empty())
+            {
+               _patient.perms.erase(grantee);
+               released_grantees.push_back(grantee);
+            }
+         }
+      });
+   }
+
+   /* Grantees left without permissions lose granted enc/dec record key */
+   for (const auto grantee : released_grantees)
+   {
+      if (is_group(grantee))
+      {
+         groupkeys _groupkeys{get_self(), grantee.value};
+         _groupkeys.erase(_groupkeys.find(patient.value));
+      }
+      else
+      {
+         doctors _doctors{get_self(), grantee.value};
+         _doctors.modify(_doctors.find(grantee.value), patient, [patient](auto &doctor) {
+            doctor.grantedkeys.erase(patient);
+         });
+      }
+   }
+
+   /* Reflect narrowed and erased permissions in doctor's patients index */
+   const auto curr_time = now();
+   for (const auto grantee : grantees)
+   {
+      update_doctor_patients(perm_info{patient, grantee}, patient_iter->perms, _permissions, curr_time);
+   }
+}
+
+void medical::rotatekey(eosio::name patient, std::vector<granted_key> &keys)
+{
+   /* Signature check */
+   require_auth(patient);
+
+   /* Empty batch check */
+   eosio_assert(!keys.empty(), "there must be at least one key");
+
+   /* Patient registration check */
+   patients _patients{get_self(), patient.value};
+   const auto patient_iter = _patients.find(patient.value);
+   eosio_assert(patient_iter != _patients.end(), "you are not registered yet");
+
+   /* Grantees are walked in the order of patient perms, so that rotation can resume after the last rotated one */
+   const auto &patient_perms = patient_iter->perms;
+   keyrotations _keyrotations{get_self(), patient.value};
+   auto rotation_iter = _keyrotations.find(keyrotation::SINGLETON_ID);
+
+   /* Batch which starts from the first grantee begins a new rotation */
+   const auto is_new_rotation = !patient_perms.empty() && keys[0].grantee == patient_perms.begin()->first;
+   auto grantee_iter = rotation_iter == _keyrotations.end() || is_new_rotation ? patient_perms.begin()
+                                                                               : patient_perms.upper_bound(rotation_iter->cursor);
+   uint32_t rotated = rotation_iter == _keyrotations.end() || is_new_rotation ? 0 : rotation_iter->rotated;
+
+   /* Grantee added before the cursor would never receive rotated key, so a changed set of grantees needs a new rotation */
+   const auto grantees = static_cast<uint32_t>(patient_perms.size());
+   eosio_assert(rotation_iter == _keyrotations.end() || is_new_rotation || rotation_iter->grantees == grantees,
+                "grantees changed since rotation began, start it again from the first grantee");
+
+   groups _groups{get_self(), get_self().value};
+   for (auto &granted_key : keys)
+   {
+      /* Every grantee must receive rotated key, so none of them can be skipped */
+      eosio_assert(grantee_iter != patient_perms.end(), "all grantees already received rotated key");
+      eosio_assert(granted_key.grantee == grantee_iter->first, "keys must follow grantees order, without skipping any of them");
+      eosio_assert(!granted_key.key.empty(), "rotated key can't be empty");
+      const auto record_key = ::keys::from_text(granted_key.key, "rotated key must be base64 of an encrypted key of at most 2048 bytes");
+
+      /* Replace key in place, permissions and their deferred deletions stay untouched */
+      if (_groups.find(granted_key.grantee.value) != _groups.end())
+      {
+         groupkeys _groupkeys{get_self(), granted_key.grantee.value};
+         const auto groupkey_iter = _groupkeys.find(patient.value);
+         eosio_assert(groupkey_iter != _groupkeys.end(), "group grantee has no granted key of this patient");
+         _groupkeys.modify(groupkey_iter, patient, [&record_key](auto &groupkey) {
+            groupkey.key = record_key;
+         });
+      }
+      else
+      {
+         doctors _doctors{get_self(), granted_key.grantee.value};
+         const auto doctor_iter = _doctors.find(granted_key.grantee.value);
+         eosio_assert(doctor_iter != _doctors.end(), "grantee is neither a registered doctor nor a group");
+         _doctors.modify(doctor_iter, patient, [&patient, &record_key](auto &doctor) {
+            doctor.grantedkeys[patient] = record_key;
+         });
+      }
+      ++grantee_iter;
+      rotated++;
+   }
+
+   /* Persist progress, or forget it once all grantees received rotated key */
+   const auto completed = grantee_iter == patient_perms.end();
+   if (completed)
+   {
+      if (rotation_iter != _keyrotations.end())
+         _keyrotations.erase(rotation_iter);
+   }
+   else
+   {
+      const auto updater = [&](auto &rotation) {
+         rotation.id = keyrotation::SINGLETON_ID;
+         rotation.cursor = keys.back().grantee;
+         rotation.rotated = rotated;
+         rotation.grantees = grantees;
+      };
+      if (rotation_iter == _keyrotations.end())
+         _keyrotations.emplace(patient, updater);
+      else
+         _keyrotations.modify(rotation_iter, patient, updater);
+   }
+
+   eosio::print(json_builder{}
+                    .add_key("rotated")
+                    .add_value(rotated)
+                    .complete_value_adding()
+                    .add_key("remaining")
+                    .add_value(static_cast<uint64_t>(std::distance(grantee_iter, patient_perms.end())))
+                    .complete_value_adding()
+                    .add_key("completed")
+                    .add_value(completed ? "true" : "false")
+                    .build()
+                    .c_str());
+}
+
+void medical::writerecord(const perm_info &perm, uint8_t specialtyid, record_info &recordinfo)
+{
+   /* Signatures check */
+   require_auth(perm.doctor);
+
+   /* Specialty id validity check */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+
+   /* Patient registration check */
+   patients _patients{get_self(), perm.patient.value};
+   const auto &patient_iter = _patients.find(perm.patient.value);
+   eosio_assert(patient_iter != _patients.end(), "this patient wasn't registered");
+
+   /* Load patient records table */
    records _records{get_self(), perm.patient.value};
    const auto &patient_records_iter = _records.find(perm.patient.value);
 
@@ -616,14 +1286,19 @@ void medical::writerecord(const perm_info &perm, uint8_t specialtyid, record_inf
    eosio_assert(recordinfo.description.length() <= 20, "description can contain up to 20 characters");
 
    /* Create patient records updater callback */
+   const auto timestamp = now();
    const auto updater = [&](auto &record) {
-      record.details[specialtyid].push_back({now(), std::move(recordinfo.hash), perm.doctor, std::move(recordinfo.description)});
+      record.details[specialtyid].push_back({timestamp, std::move(recordinfo.hash), perm.doctor, std::move(recordinfo.description)});
    };
 
    /* BTGM -> medical account can add records whether or not it has permissions */
    if (perm.doctor == get_self())
    {
       _records.modify(patient_records_iter, get_self(), updater);
+      summarize_written_record(perm.patient, specialtyid, timestamp, perm.doctor);
+      bump_chart_version(perm.patient, specialtyid);
+      notify_readers(patient_iter->perms, perm, specialtyid, timestamp);
+      index_authored_record(perm.doctor, perm.patient, specialtyid, timestamp, patient_records_iter->details.find(specialtyid)->second.back().hash);
       return;
    }
 
@@ -635,247 +1310,1547 @@ void medical::writerecord(const perm_info &perm, uint8_t specialtyid, record_inf
    /* Check if doctor really belongs to this specialty */
    eosio_assert(doctor_iter->specialtyid == specialtyid, "you are not belonging to specified specialty");
 
-   /* Doctor permissions check */
-   const auto &patient_perms = patient_iter->perms;
-   const auto doctor_assigned_perms_iter = patient_perms.find(perm.doctor);
-   eosio_assert(doctor_assigned_perms_iter != patient_perms.end(), "the patient did not give you any permissions");
-
-   /* Check if has WRITE or READ&WRITE perm */
+   /* Check if has WRITE or READ&WRITE perm, granted directly or through one of his groups */
    auto hasRequiredPermission = false;
    permissions _permissions{get_self(), perm.patient.value};
-   const auto &doctor_assigned_perms = doctor_assigned_perms_iter->second;
    const auto curr_time = now();
-   for (const auto &perm_id : doctor_assigned_perms)
-   {
-      const auto &&perm_iter = _permissions.find(perm_id);
-      /* Make use of fact that WRITE or READ & WRITE can have only 1 perm id */
-      if ((perm_iter->right == right::WRITE || perm_iter->right == right::READ_WRITE) &&    /* right check */
-          perm_iter->specialtyids[0] == specialtyid &&                                      /* specialty check */
-          ((perm_iter->interval.from == 0 && perm_iter->interval.to == 0) ||                /* infinite interval */
-           (curr_time >= perm_iter->interval.from && curr_time <= perm_iter->interval.to))) /* or inside limited interval */
+   const auto hasAnyPermission = for_each_doctor_perms(perm, patient_iter->perms, doctor_groups(perm.doctor), [&](const auto &doctor_assigned_perms) {
+      for (const auto &perm_id : doctor_assigned_perms)
       {
-         hasRequiredPermission = true;
-         break;
+         const auto &&perm_iter = _permissions.find(perm_id);
+         /* Make use of fact that WRITE or READ & WRITE have exactly 1 specialty */
+         if (access::write_check::allows_at(*perm_iter, curr_time) & (perm_iter->specialtyids[0] == specialtyid))
+         {
+            hasRequiredPermission = true;
+            break;
+         }
       }
-   }
+      return hasRequiredPermission;
+   });
+   eosio_assert(hasAnyPermission, "the patient did not give you any permissions");
    eosio_assert(hasRequiredPermission, "you don't have required permission to add records for this specialty");
 
    /* Add record under medic authority */
    _records.modify(patient_records_iter, get_self(), updater);
+   summarize_written_record(perm.patient, specialtyid, timestamp, perm.doctor);
+   bump_chart_version(perm.patient, specialtyid);
+   notify_readers(patient_iter->perms, perm, specialtyid, timestamp);
+   index_authored_record(perm.doctor, perm.patient, specialtyid, timestamp, patient_records_iter->details.find(specialtyid)->second.back().hash);
 }
 
-void medical::display_requested_record_hashes(const std::vector<uint8_t> &specialtyids, const interval &interval,
-                                              const std::map<uint8_t, std::vector<recordetails>> &record_details)
+template <typename Ring, typename Writer>
+uint64_t medical::append_to_ring(Ring &ring, eosio::name ring_name, uint64_t capacity, eosio::name payer, Writer &&writer)
 {
-   json_builder j_builder;
-   /* For each specialty for which doctor has permissions */
-   for (const auto specialty_id : specialtyids)
+   /* Reserve sequence number of the new entry */
+   ringheads _ringheads{get_self(), ring.get_scope()};
+   const auto head_iter = _ringheads.find(ring_name.value);
+   uint64_t sequence = 0;
+   if (head_iter == _ringheads.end())
    {
-      const auto &specialty_iter = record_details.find(specialty_id);
-      /* If this specialty was registered at all */
-      if (specialty_iter != record_details.end())
-      {
-         const auto &records = specialty_iter->second;
-         /* If there are records and last record timestamp is greather than the begining of the interval */
-         if (!records.empty() && records[records.size() - 1].timestamp > interval.from)
-         {
-            /* Add specialty id to output JSON and begin insert records into array */
-            j_builder.add_key(std::to_string(specialty_id)).start_array();
-            /* As timestamps are in ascending order, use binary search to get start position for next iterations */
-            const auto start_pos = get_position(records, interval.from);
-            const auto stop_pos = records.size();
-            for (auto index = start_pos; index < stop_pos; index++)
-            {
-               /* There is no need to walk further, as current timestamp is greather than end of the interval */
-               const auto &record = records[index];
-               if (record.timestamp > interval.to)
-                  break;
-               /* If all the criterias are met, add current record details to the array in the JSON */
-               j_builder.add_value(record.to_json()).complete_value_adding();
-            }
-            j_builder.undo_complete_value_adding().end_array().complete_value_adding();
-         }
-      }
+      _ringheads.emplace(payer, [ring_name](auto &head) {
+         head.ring = ring_name;
+         head.next = 1;
+      });
    }
-   /* Display completed JSON in the console */
-   eosio::print(j_builder.undo_complete_value_adding().build().c_str());
+   else
+   {
+      sequence = head_iter->next;
+      _ringheads.modify(head_iter, payer, [](auto &head) {
+         head.next++;
+      });
+   }
+
+   /* Overwrite the oldest entry once ring is full, so RAM stays constant */
+   const auto slot = sequence % capacity;
+   const auto updater = [&](auto &entry) {
+      entry.slot = slot;
+      entry.sequence = sequence;
+      writer(entry);
+   };
+   if (const auto slot_iter = ring.find(slot); slot_iter == ring.end())
+      ring.emplace(payer, updater);
+   else
+      ring.modify(slot_iter, payer, updater);
+   return sequence;
 }
 
-void medical::readrecords(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval)
+void medical::notify_readers(const std::map<eosio::name, std::vector<uint64_t>> &patient_perms, const perm_info &perm,
+                             uint8_t specialtyid, uint32_t timestamp)
 {
-   /* Signatures check */
-   require_auth(perm.doctor);
-
-   /* Empty specialties check */
-   eosio_assert(!specialtyids.empty(), "requested specialties must contain at least one specialty");
-
-   /* Unique specialty ids check */
-   eosio_assert(specialty::are_specialties_unique(specialtyids), "all specialties must be unique");
-
-   /* Limited interval check */
-   eosio_assert(!interval.is_infinite(), "requested interval can't be infinite");
-
-   /* Specialty ids validity check */
-   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
-   for (const auto specialtyid : specialtyids)
+   /* Collect doctors which hold a READ grant covering this record, directly or through a group */
+   arena_set<eosio::name> readers{};
+   permissions _permissions{get_self(), perm.patient.value};
+   groups _groups{get_self(), get_self().value};
+   for (const auto &[grantee, perm_ids] : patient_perms)
    {
-      eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
-   }
+      const auto can_read = std::any_of(perm_ids.begin(), perm_ids.end(), [&](const auto perm_id) {
+         const auto &permission = *_permissions.find(perm_id);
+         return access::read_at_check::allows_at(permission, timestamp) &&
+                std::find(permission.specialtyids.begin(), permission.specialtyids.end(), specialtyid) != permission.specialtyids.end();
+      });
+      if (!can_read)
+         continue;
 
-   /* Patient registration check */
-   patients _patients{get_self(), perm.patient.value};
-   const auto patient_iter = _patients.find(perm.patient.value);
-   eosio_assert(patient_iter != _patients.end(), "this patient wasn't registered");
+      if (const auto group_iter = _groups.find(grantee.value); group_iter != _groups.end())
+         readers.insert(group_iter->members.begin(), group_iter->members.end());
+      else
+         readers.insert(grantee);
+   }
 
-   records _records{get_self(), perm.patient.value};
+   /* Writer already knows about the record */
+   readers.erase(perm.doctor);
 
-   /* BTGM -> medical contract doesn't need any permissions */
-   /* 
-      Account equality comparation is safe, due to fact that doctor and patients are registered on different tables
-      So doctor can't be patient and doctor on the same time
-      If the doctor will have the oportunity to be and patient on the same time, this equality won't work
-    */
-   if (perm.doctor == get_self() || perm.doctor == perm.patient)
+   for (const auto reader : readers)
    {
-      display_requested_record_hashes(specialtyids, interval, _records.find(perm.patient.value)->details);
-      return;
+      /* Grants may outlive the doctor registration, removed doctors get no feed */
+      doctors _doctors{get_self(), reader.value};
+      if (_doctors.find(reader.value) == _doctors.end())
+         continue;
+
+      inbox _inbox{get_self(), reader.value};
+      append_to_ring(_inbox, eosio::name{"inbox"}, inboxentry::CAPACITY, get_self(), [&](auto &entry) {
+         entry.patient = perm.patient;
+         entry.specialtyid = specialtyid;
+         entry.timestamp = timestamp;
+      });
    }
+}
 
-   /* Check if specified doctor is medic for real */
-   doctors _doctors{get_self(), perm.doctor.value};
-   const auto doctor_iter = _doctors.find(perm.doctor.value);
-   eosio_assert(doctor_iter != _doctors.end(), "this doctor wan't registered before");
+void medical::pollinbox(eosio::name doctor, uint64_t since)
+{
+   /* Signature check, only doctor is able to see his feed */
+   require_auth(doctor);
 
-   /* Doctor permissions check */
-   const auto &patient_perms = patient_iter->perms;
-   const auto doctor_assigned_perms_iter = patient_perms.find(perm.doctor);
-   eosio_assert(doctor_assigned_perms_iter != patient_perms.end(), "the patient did not give you any permissions");
+   ringheads _ringheads{get_self(), doctor.value};
+   const auto head_iter = _ringheads.find(eosio::name{"inbox"}.value);
+   const uint64_t next = head_iter == _ringheads.end() ? 0 : head_iter->next;
 
-   /* Check if has READ or READ & WRITE perm */
-   permissions _permissions{get_self(), perm.patient.value};
+   /* Entries older than ring capacity were overwritten, client has to fall back to readrecords */
+   const auto oldest = next > inboxentry::CAPACITY ? next - inboxentry::CAPACITY : 0;
+   const auto truncated = since < oldest;
 
-   auto number_of_specialties_satisfied = 0;
-   const auto number_of_specialties_requested = specialtyids.size();
-   const auto &doctor_assigned_perms = doctor_assigned_perms_iter->second;
+   /* since is inclusive: it is the first sequence to return, i.e. next reported by the previous poll, 0 on the first one */
+   json_builder j_builder;
+   j_builder.add_key("next").add_value(next).complete_value_adding();
+   j_builder.add_key("truncated").add_value(truncated ? "true" : "false").complete_value_adding();
+   j_builder.add_key("entries").start_array();
+   inbox _inbox{get_self(), doctor.value};
+   for (auto sequence = std::max(since, oldest); sequence < next; sequence++)
+   {
+      const auto &entry = _inbox.get(sequence % inboxentry::CAPACITY);
+      j_builder.start_object()
+          .add_key("sequence")
+          .add_value(entry.sequence)
+          .complete_value_adding()
+          .add_key("patient")
+          .add_string_value(entry.patient.to_string())
+          .complete_value_adding()
+          .add_key("specialtyid")
+          .add_value(entry.specialtyid)
+          .complete_value_adding()
+          .add_key("timestamp")
+          .add_value(entry.timestamp)
+          .end_object()
+          .complete_value_adding();
+   }
+   eosio::print(j_builder.undo_complete_value_adding().end_array().build().c_str());
+}
 
-   std::map<uint8_t, bool> satisfied_specialties;
-   for (const auto specialty_id : specialtyids)
-      satisfied_specialties[specialty_id] = false;
+void medical::mypatients(eosio::name doctor)
+{
+   /* Signature check, only doctor is able to see his patients */
+   require_auth(doctor);
 
-   for (const auto &perm_id : doctor_assigned_perms)
+   /* Patients granting to doctor directly or through his groups, with union of rights and closest expiry */
+   arena_map<eosio::name, std::pair<uint8_t, uint32_t>> merged{};
+   auto grantees = doctor_groups(doctor);
+   grantees.push_back(doctor);
+   const auto curr_time = now();
+   for (const auto grantee : grantees)
    {
-      const auto &&perm_iter = _permissions.find(perm_id);
-      /* If we found perms for all specialties stop */
-      if (number_of_specialties_satisfied == number_of_specialties_requested)
-         break;
-      /* Check is this perm can satisfy unsatisfied specialties */
-      if ((perm_iter->right == right::READ || perm_iter->right == right::READ_WRITE) &&           /* right check */
-          ((perm_iter->interval.from == 0 && perm_iter->interval.to == 0) ||                      /* infinite interval */
-           (interval.from >= perm_iter->interval.from && interval.to <= perm_iter->interval.to))) /* or inside limited interval */
+      docpatients _docpatients{get_self(), grantee.value};
+      for (const auto &docpatient : _docpatients)
       {
-         for (const auto &[specialty_id, is_satisfied] : satisfied_specialties)
+         auto grant_bits = access::bits_of(docpatient.right);
+         auto grant_expiry = docpatient.nextexpiry;
+
+         /* Limited READ permissions expire without any action updating the index, so passed expiry is summarized again */
+         if (grant_expiry != 0 && grant_expiry < curr_time)
          {
-            if (!is_satisfied)
-            {
-               const auto _specialty_id_copy_for_lambda_capture = specialty_id;
-               const auto found_iter = std::find_if(perm_iter->specialtyids.begin(), perm_iter->specialtyids.end(),
-                                                    [_specialty_id_copy_for_lambda_capture](const auto curr_spec_id) {
-                                                       return curr_spec_id == _specialty_id_copy_for_lambda_capture;
-                                                    });
-               if (found_iter != perm_iter->specialtyids.end())
-               {
-                  satisfied_specialties[specialty_id] = true;
-                  number_of_specialties_satisfied++;
-               }
-            }
+            std::tie(grant_bits, grant_expiry) = live_grants(perm_info{docpatient.patient, grantee}, curr_time);
+            if (grant_bits == 0)
+               continue;
          }
+
+         auto &[right_bits, next_expiry] = merged[docpatient.patient];
+         right_bits |= grant_bits;
+         if (grant_expiry != 0 && (next_expiry == 0 || grant_expiry < next_expiry))
+            next_expiry = grant_expiry;
       }
    }
-   eosio_assert(number_of_specialties_satisfied != 0, "you don't have required permission to read records for all specialties");
 
-   /* Collect satisfied specialties */
-   std::vector<uint8_t> satisfied_specialties_ids{};
-   for (const auto &[specialty_id, is_satisfied] : satisfied_specialties)
+   json_builder j_builder;
+   j_builder.add_key("patients").start_array();
+   for (const auto &[patient, summary] : merged)
    {
-      if (is_satisfied)
-      {
-         satisfied_specialties_ids.push_back(specialty_id);
-      }
+      j_builder.start_object()
+          .add_key("patient")
+          .add_string_value(patient.to_string())
+          .complete_value_adding()
+          .add_key("right")
+          /* Union of rights maps back to right id by the same offset */
+          .add_value(summary.first - 1)
+          .complete_value_adding()
+          .add_key("nextexpiry")
+          .add_value(summary.second)
+          .end_object()
+          .complete_value_adding();
    }
+   eosio::print(j_builder.undo_complete_value_adding().end_array().build().c_str());
+}
+
+void medical::log_access(const perm_info &perm, const arena_vector<uint8_t> &specialtyids, const interval &interval)
+{
+   /* Patient reading his own chart is not logged */
+   if (perm.doctor == perm.patient)
+      return;
 
-   /* Display record hashes */
-   display_requested_record_hashes(satisfied_specialties_ids, interval, _records.find(perm.patient.value)->details);
+   accesses _accesses{get_self(), perm.patient.value};
+   append_to_ring(_accesses, eosio::name{"accesses"}, accessentry::CAPACITY, get_self(), [&](auto &entry) {
+      entry.doctor = perm.doctor;
+      entry.lowspecialties = 0;
+      entry.highspecialties = 0;
+      for (const auto specialtyid : specialtyids)
+         entry.add_specialty(specialtyid);
+      entry.interval = interval;
+      entry.timestamp = now();
+   });
 }
 
-std::string serialize_records_to_json(const std::map<uint8_t, std::vector<medical::recordetails>> &record_details,
-                                      const std::map<uint8_t, std::string> &specialities_mapping)
+void medical::accesslog(eosio::name patient, uint32_t count)
 {
+   /* Signature check, only patient is able to see who read his chart */
+   require_auth(patient);
+
+   eosio_assert(count != 0, "count must be greater than 0");
+
+   ringheads _ringheads{get_self(), patient.value};
+   const auto head_iter = _ringheads.find(eosio::name{"accesses"}.value);
+   const uint64_t next = head_iter == _ringheads.end() ? 0 : head_iter->next;
+
+   /* Most recent accesses first, at most as many as ring still holds */
+   const auto available = std::min<uint64_t>(next, accessentry::CAPACITY);
+   const auto returned = std::min<uint64_t>(available, count);
+
    json_builder j_builder;
-   for (const auto &[specialty_id, records] : record_details)
+   j_builder.add_key("accesses").start_array();
+   accesses _accesses{get_self(), patient.value};
+   for (auto sequence = next; sequence > next - returned; sequence--)
    {
-      j_builder.add_key(specialities_mapping.find(specialty_id)->second).start_array();
-      for (const auto &record : records)
+      const auto &entry = _accesses.get((sequence - 1) % accessentry::CAPACITY);
+      j_builder.start_object()
+          .add_key("sequence")
+          .add_value(entry.sequence)
+          .complete_value_adding()
+          .add_key("doctor")
+          .add_string_value(entry.doctor.to_string())
+          .complete_value_adding()
+          .add_key("specialtyids")
+          .start_array();
+      for (auto specialtyid = 0; specialtyid <= UINT8_MAX; specialtyid++)
       {
-         j_builder.add_value(record.to_json()).complete_value_adding();
+         if (entry.has_specialty(specialtyid))
+            j_builder.add_value(specialtyid).complete_value_adding();
       }
-      j_builder.undo_complete_value_adding().end_array().complete_value_adding();
+      j_builder.undo_complete_value_adding()
+          .end_array()
+          .complete_value_adding()
+          .add_key("from")
+          .add_value(entry.interval.from)
+          .complete_value_adding()
+          .add_key("to")
+          .add_value(entry.interval.to)
+          .complete_value_adding()
+          .add_key("timestamp")
+          .add_value(entry.timestamp)
+          .end_object()
+          .complete_value_adding();
    }
-   return j_builder.undo_complete_value_adding().build();
+   eosio::print(j_builder.undo_complete_value_adding().end_array().build().c_str());
 }
 
-void medical::recordstab(const eosio::name patient)
+void medical::auditdoc(eosio::name doctor, const interval &interval, uint64_t cursor, uint32_t limit)
 {
-   /* Signature check, only patient is able to see all of his records */
-   require_auth(patient);
+   /* Only contract is allowed to audit doctors */
+   require_auth(get_self());
 
-   /* 
-      Check if this account is registered as patient by loading his records table
-      This works because:
-         1) only patiens can have records
-         2) at registration for every patient is created a table entry scopped with his account name
-         3) doctors can't be registered as patient and doctor at the same time
-   */
-   records _records{get_self(), patient.value};
-   const auto &patient_records_iter = _records.find(patient.value);
-   eosio_assert(patient_records_iter != _records.end(), "you are not a registered patient");
+   /* Interval validity check, infinite interval audits whole doctor history */
+   eosio_assert(interval.is_valid(), "interval is not valid");
+   eosio_assert(limit != 0, "limit must be greater than 0");
+
+   /* Resume from cursor returned by previous page, or begin with the interval */
+   const auto to = interval.is_infinite() ? UINT32_MAX : interval.to;
+   const auto first_id = std::max(cursor, authoredrec::make_id(interval.from, 0));
+
+   json_builder j_builder;
+   j_builder.add_key("records").start_array();
+   authoredrecs _authoredrecs{get_self(), doctor.value};
+   auto authored_iter = _authoredrecs.lower_bound(first_id);
+   for (uint32_t count = 0; authored_iter != _authoredrecs.end() && authored_iter->timestamp() <= to && count < limit; ++authored_iter, ++count)
+   {
+      j_builder.start_object()
+          .add_key("patient")
+          .add_string_value(authored_iter->patient.to_string())
+          .complete_value_adding()
+          .add_key("specialtyid")
+          .add_value(authored_iter->specialtyid)
+          .complete_value_adding()
+          .add_key("timestamp")
+          .add_value(authored_iter->timestamp())
+          .complete_value_adding()
+          .add_key("hash")
+          .add_string_value(authored_iter->hash)
+          .end_object()
+          .complete_value_adding();
+   }
+   j_builder.undo_complete_value_adding().end_array().complete_value_adding();
 
-   /* Serialize and display all records */
-   eosio::print(serialize_records_to_json(patient_records_iter->details,
-                                          _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet").mapping));
+   /* Cursor of the next page, 0 when there are no more records in the interval */
+   const auto has_more = authored_iter != _authoredrecs.end() && authored_iter->timestamp() <= to;
+   eosio::print(j_builder.add_key("cursor").add_value(has_more ? authored_iter->id : 0).build().c_str());
 }
 
-void medical::removerecord(eosio::name patient, uint8_t specialtyid, std::string hash)
+void medical::summarize_written_record(eosio::name patient, uint8_t specialtyid, uint32_t timestamp, eosio::name writer)
 {
-   /* Only contract is allowed to do this action */
-   require_auth(get_self());
+   summaries _summaries{get_self(), patient.value};
+   const auto summary_iter = _summaries.find(specialtyid);
+   if (summary_iter == _summaries.end())
+   {
+      _summaries.emplace(get_self(), [&](auto &summary) {
+         summary.specialtyid = specialtyid;
+         summary.count = 1;
+         summary.first = timestamp;
+         summary.last = timestamp;
+         summary.lastwriter = writer;
+      });
+   }
+   else
+   {
+      /* Records are appended, so only the newest one changes */
+      _summaries.modify(summary_iter, get_self(), [&](auto &summary) {
+         summary.count++;
+         summary.last = timestamp;
+         summary.lastwriter = writer;
+      });
+   }
+}
 
-   /* Patient account validity check */
-   eosio_assert(is_account(patient), "this account doesn't exists");
+void medical::summarize_removed_record(eosio::name patient, uint8_t specialtyid, const std::vector<recordetails> &records,
+                                       const arena_vector<uint32_t> &tombstoned)
+{
+   summaries _summaries{get_self(), patient.value};
+   const auto summary_iter = _summaries.find(specialtyid);
+   /* Summary can be missing only for patients which were not migrated yet */
+   if (summary_iter == _summaries.end())
+      return;
 
-   /* Specialty id validity check */
-   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
-   eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+   /* Removed record could be the oldest or the newest one, so refresh both ends */
+   summarize_live_records(_summaries, summary_iter, specialtyid, records, tombstoned);
+}
 
-   /* Patient registration check */
-   records _records{get_self(), patient.value};
-   const auto &patient_records_iter = _records.find(patient.value);
-   eosio_assert(patient_records_iter != _records.end(), "this patient doesn't have any records");
+void medical::summarize_live_records(summaries &_summaries, summaries::const_iterator summary_iter, uint8_t specialtyid,
+                                     const std::vector<recordetails> &records, const arena_vector<uint32_t> &tombstoned)
+{
+   /* Tombstoned records were already removed from the chart */
+   if (records.size() == tombstoned.size())
+   {
+      if (summary_iter != _summaries.end())
+         _summaries.erase(summary_iter);
+      return;
+   }
 
-   /* Specialty records existence check */
-   const auto &specialty_records_iter = patient_records_iter->details.find(specialtyid);
-   eosio_assert(specialty_records_iter != patient_records_iter->details.end(), "this patient has no records for this specialty");
+   auto first = 0;
+   while (is_tombstoned(tombstoned, first))
+      first++;
+   auto last = records.size() - 1;
+   while (is_tombstoned(tombstoned, last))
+      last--;
+
+   const auto updater = [&](auto &summary) {
+      summary.specialtyid = specialtyid;
+      summary.count = records.size() - tombstoned.size();
+      summary.first = records[first].timestamp;
+      summary.last = records[last].timestamp;
+      summary.lastwriter = records[last].doctor;
+   };
+   if (summary_iter == _summaries.end())
+      _summaries.emplace(get_self(), updater);
+   else
+      _summaries.modify(summary_iter, get_self(), updater);
+}
 
-   /* Record existence check */
-   const auto &records = specialty_records_iter->second;
-   const auto index = find(records, [&hash](const auto &record) {
-      return record.hash == hash;
-   });
-   eosio_assert(index != -1, "this record doesn't exist");
+void medical::schedule_compaction(eosio::name patient)
+{
+   /*
+      Every removal postpones compaction of the patient, so a burst of removals is compacted together once it settles
+      Sender id is the patient account, which can't collide with permission ids used by scheduled permission removals
+   */
+   eosio::transaction t{};
+   t.actions.emplace_back(
+       eosio::permission_level(get_self(), eosio::name{"active"}),
+       get_self(),
+       eosio::name{"compact"},
+       std::make_tuple(patient, tombstone::COMPACTION_BATCH));
+   t.delay_sec = tombstone::COMPACTION_DELAY_SEC;
+   t.send(patient.value, get_self(), true);
+}
 
-   /* Remove record */
-   _records.modify(patient_records_iter, patient, [index, specialtyid](auto &record) {
-      remove(record.details[specialtyid], index);
-   });
+void medical::bump_chart_version(eosio::name patient, uint8_t specialtyid)
+{
+   /* Both specialty and whole chart versions change */
+   chartversions _chartversions{get_self(), patient.value};
+   for (const auto key : {static_cast<uint64_t>(specialtyid), chartversion::PATIENT_KEY})
+   {
+      if (const auto version_iter = _chartversions.find(key); version_iter == _chartversions.end())
+      {
+         _chartversions.emplace(get_self(), [key](auto &version) {
+            version.key = key;
+            version.version = 1;
+         });
+      }
+      else
+      {
+         _chartversions.modify(version_iter, get_self(), [](auto &version) {
+            version.version++;
+         });
+      }
+   }
+}
+
+uint64_t medical::chart_version(eosio::name patient)
+{
+   chartversions _chartversions{get_self(), patient.value};
+   const auto version_iter = _chartversions.find(chartversion::PATIENT_KEY);
+   return chartversion::seal(chartversion::fold(0, version_iter == _chartversions.end() ? 0 : version_iter->version));
+}
+
+template <typename SpecialtyIds>
+uint64_t medical::chart_version(eosio::name patient, const SpecialtyIds &specialtyids, const interval &interval)
+{
+   /* 
+      Answer depends on the interval, on which specialties are readable and on their versions, so (id, version) pairs
+      are hashed rather than summed, which would let one specialty losing readability hide another one changing
+   */
+   auto version = chartversion::fold(chartversion::fold(0, interval.from), interval.to);
+   chartversions _chartversions{get_self(), patient.value};
+   for (const auto specialtyid : specialtyids)
+   {
+      const auto version_iter = _chartversions.find(specialtyid);
+      version = chartversion::fold(chartversion::fold(version, specialtyid), version_iter == _chartversions.end() ? 0 : version_iter->version);
+   }
+   return chartversion::seal(version);
+}
+
+template <typename SpecialtyIds>
+arena_vector<uint8_t> medical::specialties_with_records_since(eosio::name patient, const SpecialtyIds &specialtyids, uint32_t from)
+{
+   arena_vector<uint8_t> recent_specialtyids{specialtyids.begin(), specialtyids.end()};
+
+   /* Summaries can be trusted only after patient was migrated */
+   if (account_version(patient) < schema::SUMMARIES_VERSION)
+      return recent_specialtyids;
+
+   /* Drop specialties which have no records or whose newest record is before the begining of the interval */
+   summaries _summaries{get_self(), patient.value};
+   recent_specialtyids.erase(std::remove_if(recent_specialtyids.begin(), recent_specialtyids.end(), [&](const auto specialtyid) {
+                                const auto summary_iter = _summaries.find(specialtyid);
+                                return summary_iter == _summaries.end() || summary_iter->last < from;
+                             }),
+                             recent_specialtyids.end());
+   return recent_specialtyids;
+}
+
+template <typename SpecialtyIds>
+json_builder &medical::add_requested_records(json_builder &j_builder, const SpecialtyIds &specialtyids, const interval &interval,
+                                            const packed_record_row &packed_records, const tombstones &_tombstones)
+{
+   /* For each specialty for which doctor has permissions */
+   for (const auto specialty_id : specialtyids)
+   {
+      const auto records = packed_records.specialty(specialty_id);
+      /* If there are records and last record timestamp is not before the begining of the interval */
+      if (!records.empty() && records.timestamp(records.size() - 1) >= interval.from)
+      {
+         /* Add specialty id to output JSON and begin insert records into array */
+         j_builder.add_key(specialty_id).start_array();
+         /* As timestamps are in ascending order, use binary search over packed records to get start position */
+         const auto start_pos = records.lower_bound(interval.from);
+         const auto stop_pos = records.size();
+         /* Tombstones are in ascending order too, so they are skipped while walking */
+         const auto tombstoned = tombstoned_records(_tombstones, specialty_id);
+         auto tombstone_iter = std::lower_bound(tombstoned.begin(), tombstoned.end(), start_pos);
+         for (auto index = start_pos; index < stop_pos; index++)
+         {
+            /* There is no need to walk further, as current timestamp is greather than end of the interval */
+            if (records.timestamp(index) > interval.to)
+               break;
+            if (tombstone_iter != tombstoned.end() && *tombstone_iter == index)
+            {
+               ++tombstone_iter;
+               continue;
+            }
+            /* If all the criterias are met, add current record details to the array in the JSON */
+            records[index].to_json(j_builder).complete_value_adding();
+         }
+         j_builder.undo_complete_value_adding().end_array().complete_value_adding();
+      }
+   }
+   return j_builder.undo_complete_value_adding();
+}
+
+const char *medical::check_read_request(const std::vector<uint8_t> &specialtyids, const interval &interval, const specialty &speciality)
+{
+   /* Empty specialties check */
+   if (specialtyids.empty())
+      return "requested specialties must contain at least one specialty";
+
+   /* Unique specialty ids check */
+   if (!specialty::are_specialties_unique(specialtyids))
+      return "all specialties must be unique";
+
+   /* Limited interval check */
+   if (interval.is_infinite())
+      return "requested interval can't be infinite";
+
+   /* Specialty ids validity check */
+   for (const auto specialtyid : specialtyids)
+   {
+      if (speciality.mapping.find(specialtyid) == speciality.mapping.end())
+         return "speciality id is not valid";
+   }
+   return nullptr;
+}
+
+const char *medical::evaluate_read_request(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval,
+                                           const specialty &speciality, const arena_vector<eosio::name> &groups,
+                                           arena_vector<uint8_t> &readable_specialtyids)
+{
+   /* Requested specialties and interval check */
+   if (const auto error = check_read_request(specialtyids, interval, speciality); error != nullptr)
+      return error;
+
+   /* Patient registration check */
+   patients _patients{get_self(), perm.patient.value};
+   const auto patient_iter = _patients.find(perm.patient.value);
+   if (patient_iter == _patients.end())
+      return is_local_patient(perm.patient) ? "this patient wasn't registered" : "this patient belongs to another shard";
+
+   /* BTGM -> medical contract doesn't need any permissions */
+   /* 
+      Account equality comparation is safe, due to fact that doctor and patients are registered on different tables
+      So doctor can't be patient and doctor on the same time
+      If the doctor will have the oportunity to be and patient on the same time, this equality won't work
+    */
+   if (perm.doctor == get_self() || perm.doctor == perm.patient)
+   {
+      readable_specialtyids.assign(specialtyids.begin(), specialtyids.end());
+      return nullptr;
+   }
+
+   /* Check if has READ or READ & WRITE perm, granted directly or through one of his groups */
+   permissions _permissions{get_self(), perm.patient.value};
+
+   access::specialty_set requested{};
+   for (const auto specialty_id : specialtyids)
+      requested.insert(specialty_id);
+   access::specialty_set satisfied{};
+
+   const auto hasAnyPermission = for_each_doctor_perms(perm, patient_iter->perms, groups, [&](const auto &doctor_assigned_perms) {
+      for (const auto &perm_id : doctor_assigned_perms)
+      {
+         /* Permissions which don't allow reading the whole interval contribute no specialties */
+         const auto &permission = *_permissions.find(perm_id);
+         if (access::read_check::allows(permission, interval.from, interval.to))
+            satisfied.add_granted(permission.specialtyids, requested);
+      }
+      /* If we found perms for all specialties stop */
+      return satisfied == requested;
+   });
+   if (!hasAnyPermission)
+      return "the patient did not give you any permissions";
+   if (satisfied.empty())
+      return "you don't have required permission to read records for all specialties";
+
+   /* Collect satisfied specialties, in ascending order */
+   satisfied.for_each([&readable_specialtyids](const auto specialty_id) {
+      readable_specialtyids.push_back(specialty_id);
+   });
+   return nullptr;
+}
+
+void medical::readrecords(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval, uint64_t knownversion)
+{
+   /* Signatures check */
+   require_auth(perm.doctor);
+
+   /* Check if specified doctor is medic for real, medical contract and patient himself don't need to be */
+   const auto is_doctor = perm.doctor != get_self() && perm.doctor != perm.patient;
+   if (is_doctor)
+   {
+      doctors _doctors{get_self(), perm.doctor.value};
+      eosio_assert(_doctors.find(perm.doctor.value) != _doctors.end(), "this doctor wan't registered before");
+   }
+
+   /* Request validity and permissions check */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   arena_vector<uint8_t> readable_specialtyids{};
+   const auto error = evaluate_read_request(perm, specialtyids, interval, speciality,
+                                            is_doctor ? doctor_groups(perm.doctor) : arena_vector<eosio::name>{}, readable_specialtyids);
+   if (error != nullptr)
+   {
+      eosio_assert(false, error);
+   }
+   log_access(perm, readable_specialtyids, interval);
+
+   /* 
+      Answer only with version if client's copy of readable specialties is up to date
+      Clients which keep no copies get the specialty keyed records alone
+   */
+   json_builder j_builder;
+   const auto is_versioned = knownversion != 0;
+   if (is_versioned)
+   {
+      if (add_chart_version(j_builder, chart_version(perm.patient, readable_specialtyids, interval), knownversion))
+      {
+         eosio::print(j_builder.build().c_str());
+         return;
+      }
+      j_builder.add_key("records").start_object();
+   }
+
+   /* Patient records are loaded only if some specialty has records in the interval */
+   readable_specialtyids = specialties_with_records_since(perm.patient, readable_specialtyids, interval.from);
+   if (!readable_specialtyids.empty())
+   {
+      packed_record_row packed_records{};
+      packed_records.load(get_self(), record::TABLE_NAME, perm.patient);
+      tombstones _tombstones{get_self(), perm.patient.value};
+      add_requested_records(j_builder, readable_specialtyids, interval, packed_records, _tombstones);
+   }
+   j_builder.undo_complete_value_adding();
+   if (is_versioned)
+      j_builder.end_object();
+
+   /* Display completed JSON in the console */
+   eosio::print(j_builder.build().c_str());
+}
+
+void medical::timeline(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval, uint32_t limit)
+{
+   /* Signatures check */
+   require_auth(perm.doctor);
+
+   /* Limit check */
+   eosio_assert(limit != 0, "limit must be greater than 0");
+
+   /* Check if specified doctor is medic for real, medical contract and patient himself don't need to be */
+   const auto is_doctor = perm.doctor != get_self() && perm.doctor != perm.patient;
+   if (is_doctor)
+   {
+      doctors _doctors{get_self(), perm.doctor.value};
+      eosio_assert(_doctors.find(perm.doctor.value) != _doctors.end(), "this doctor wan't registered before");
+   }
+
+   /* Request validity and permissions check */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   arena_vector<uint8_t> readable_specialtyids{};
+   const auto error = evaluate_read_request(perm, specialtyids, interval, speciality,
+                                            is_doctor ? doctor_groups(perm.doctor) : arena_vector<eosio::name>{}, readable_specialtyids);
+   if (error != nullptr)
+   {
+      eosio_assert(false, error);
+   }
+   log_access(perm, readable_specialtyids, interval);
+
+   /* Cursor over records of one specialty, walking from the newest record in the interval down to its begining */
+   struct cursor
+   {
+      uint8_t specialtyid;
+      packed_record_row::specialty_view records;
+      size_t begin;
+      size_t next;
+      arena_vector<uint32_t> tombstoned;
+
+      /* Moves past tombstoned records, returns false when cursor is exhausted */
+      bool settle()
+      {
+         while (next > begin && is_tombstoned(tombstoned, next - 1))
+            next--;
+         return next > begin;
+      }
+      uint32_t timestamp() const { return records.timestamp(next - 1); }
+      packed_record_row::record_view current() const { return records[next - 1]; }
+   };
+   const auto is_older = [](const cursor &lhs, const cursor &rhs) {
+      return lhs.timestamp() < rhs.timestamp();
+   };
+
+   /* Build heap of cursors, patient records are loaded only if some specialty has records in the interval */
+   readable_specialtyids = specialties_with_records_since(perm.patient, readable_specialtyids, interval.from);
+   packed_record_row packed_records{};
+   tombstones _tombstones{get_self(), perm.patient.value};
+   arena_vector<cursor> heap{};
+   if (!readable_specialtyids.empty())
+   {
+      packed_records.load(get_self(), record::TABLE_NAME, perm.patient);
+      for (const auto specialtyid : readable_specialtyids)
+      {
+         const auto records = packed_records.specialty(specialtyid);
+         if (records.empty())
+            continue;
+         /* Interval bounds are found with binary search over packed records, so nothing outside of the output is visited */
+         cursor specialty_cursor{specialtyid, records, records.lower_bound(interval.from), records.upper_bound(interval.to),
+                                 tombstoned_records(_tombstones, specialtyid)};
+         if (specialty_cursor.settle())
+            heap.push_back(std::move(specialty_cursor));
+      }
+      std::make_heap(heap.begin(), heap.end(), is_older);
+   }
+
+   /* Merge cursors newest first, until limit records were produced */
+   json_builder j_builder;
+   j_builder.add_key("records").start_array();
+   for (uint32_t count = 0; !heap.empty() && count < limit; count++)
+   {
+      std::pop_heap(heap.begin(), heap.end(), is_older);
+      auto &newest = heap.back();
+      j_builder.start_object().add_key("specialtyid").add_value(newest.specialtyid).complete_value_adding().add_key("record");
+      newest.current().to_json(j_builder).end_object().complete_value_adding();
+
+      newest.next--;
+      if (newest.settle())
+         std::push_heap(heap.begin(), heap.end(), is_older);
+      else
+         heap.pop_back();
+   }
+   j_builder.undo_complete_value_adding().end_array().complete_value_adding();
+
+   /* Display completed JSON in the console */
+   eosio::print(j_builder.add_key("more").add_value(heap.empty() ? "false" : "true").build().c_str());
+}
+
+bool medical::add_chart_version(json_builder &j_builder, uint64_t version, uint64_t knownversion)
+{
+   j_builder.add_key("version").add_value(version).complete_value_adding();
+   /* Versions are never 0 nor chartversion::NO_COPY, so clients without a copy are always answered with records */
+   const auto is_not_modified = knownversion == version;
+   if (is_not_modified)
+      j_builder.add_key("notmodified").add_value("true");
+   return is_not_modified;
+}
+
+void medical::readbatch(eosio::name doctor, const std::vector<read_request> &requests)
+{
+   /* Signature check, done once for all requests */
+   require_auth(doctor);
+
+   /* Empty requests check */
+   eosio_assert(!requests.empty(), "there must be at least one request");
+
+   /* Check if specified doctor is medic for real, done once for all requests */
+   const auto is_doctor = doctor != get_self();
+   if (is_doctor)
+   {
+      doctors _doctors{get_self(), doctor.value};
+      eosio_assert(_doctors.find(doctor.value) != _doctors.end(), "this doctor wan't registered before");
+   }
+
+   /* Specialties nomenclature and doctor groups are loaded once for all requests */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   const auto groups = is_doctor ? doctor_groups(doctor) : arena_vector<eosio::name>{};
+
+   /* Evaluate each request on its own, so that one failing patient doesn't fail the whole batch */
+   json_builder j_builder;
+   j_builder.add_key("results").start_array();
+   for (const auto &request : requests)
+   {
+      arena_vector<uint8_t> readable_specialtyids{};
+      const auto error = evaluate_read_request({request.patient, doctor}, request.specialtyids, request.interval, speciality, groups, readable_specialtyids);
+      if (error == nullptr)
+         log_access({request.patient, doctor}, readable_specialtyids, request.interval);
+
+      j_builder.start_object()
+          .add_key("patient")
+          .add_string_value(request.patient.to_string())
+          .complete_value_adding()
+          .add_key("status")
+          .add_string_value(error == nullptr ? "ok" : error);
+      /* Patients of other shards are named with their shard, so that client resends their requests there */
+      if (error != nullptr)
+      {
+         if (const auto shard = patient_shard(request.patient); shard != get_self())
+            j_builder.complete_value_adding().add_key("shard").add_string_value(shard.to_string());
+      }
+      /* Records are added only if client's copy of readable specialties is outdated */
+      if (error == nullptr &&
+          !add_chart_version(j_builder.complete_value_adding(), chart_version(request.patient, readable_specialtyids, request.interval), request.knownversion))
+      {
+         j_builder.add_key("records").start_object();
+         /* Patient records are loaded only if some specialty has records in the interval */
+         readable_specialtyids = specialties_with_records_since(request.patient, readable_specialtyids, request.interval.from);
+         if (!readable_specialtyids.empty())
+         {
+            packed_record_row packed_records{};
+            packed_records.load(get_self(), record::TABLE_NAME, request.patient);
+            tombstones _tombstones{get_self(), request.patient.value};
+            add_requested_records(j_builder, readable_specialtyids, request.interval, packed_records, _tombstones);
+         }
+         j_builder.end_object();
+      }
+      j_builder.end_object().complete_value_adding();
+   }
+
+   /* Display completed JSON in the console */
+   eosio::print(j_builder.undo_complete_value_adding().end_array().build().c_str());
+}
+
+void medical::importrecs(eosio::name patient, std::vector<import_record> &batch)
+{
+   /* Only contract is allowed to import records */
+   require_auth(get_self());
+
+   /* Empty batch check */
+   eosio_assert(!batch.empty(), "there must be at least one record");
+
+   /* Patient registration check */
+   records _records{get_self(), patient.value};
+   const auto patient_records_iter = _records.find(patient.value);
+   eosio_assert(patient_records_iter != _records.end(), "this patient wasn't registered");
+
+   /* Imported records validity check */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   const auto current_time = now();
+   arena_set<eosio::name> existing_authors;
+   for (const auto &imported : batch)
+   {
+      eosio_assert(speciality.mapping.find(imported.specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+      /*
+         Historical records may come from doctors who left or never joined, so authors need not be registered, but they must
+         be accounts: records are indexed under author scope, which a name nobody owns could later be claimed for.
+         Batches usually repeat a few authors, so each of them is looked up once
+      */
+      if (existing_authors.find(imported.doctor) == existing_authors.end())
+      {
+         eosio_assert(is_account(imported.doctor), "authoring doctor of imported record is not an existing account");
+         existing_authors.insert(imported.doctor);
+      }
+      eosio_assert(imported.timestamp != 0 && imported.timestamp <= current_time, "imported record timestamp must be in the past");
+      eosio_assert(imported.description.length() <= 20, "description can contain up to 20 characters");
+   }
+
+   /* Sort batch by specialty and timestamp, so that history of each specialty is merged with a single pass */
+   std::stable_sort(batch.begin(), batch.end(), [](const auto &lhs, const auto &rhs) {
+      return lhs.specialtyid < rhs.specialtyid || (lhs.specialtyid == rhs.specialtyid && lhs.timestamp < rhs.timestamp);
+   });
+
+   /* Index imported records by authoring doctor, before their hashes are moved into history */
+   for (const auto &imported : batch)
+      index_authored_record(imported.doctor, patient, imported.specialtyid, imported.timestamp, imported.hash);
+
+   /* Merge is done with a single rewrite of records row, positions of tombstoned records shift with it */
+   tombstones _tombstones{get_self(), patient.value};
+   arena_map<uint8_t, arena_vector<uint32_t>> tombstoned{};
+   _records.modify(patient_records_iter, get_self(), [&](auto &record) {
+      for (auto first = batch.begin(); first != batch.end();)
+      {
+         const auto specialtyid = first->specialtyid;
+         const auto last = std::find_if(first, batch.end(), [specialtyid](const auto &imported) {
+            return imported.specialtyid != specialtyid;
+         });
+         auto &positions = tombstoned[specialtyid] = tombstoned_records(_tombstones, specialtyid);
+         merge_records(record.details[specialtyid], first, last, positions);
+         first = last;
+      }
+   });
+
+   summaries _summaries{get_self(), patient.value};
+   for (const auto &[specialtyid, positions] : tombstoned)
+   {
+      /* Tombstones are keyed by position, so they are written again with shifted positions */
+      if (!positions.empty())
+      {
+         auto tombstone_iter = _tombstones.lower_bound(tombstone::make_id(specialtyid, 0));
+         while (tombstone_iter != _tombstones.end() && tombstone_iter->specialtyid() == specialtyid)
+            tombstone_iter = _tombstones.erase(tombstone_iter);
+         for (const auto position : positions)
+         {
+            _tombstones.emplace(get_self(), [specialtyid = specialtyid, position](auto &entry) {
+               entry.id = tombstone::make_id(specialtyid, position);
+            });
+         }
+      }
+
+      /* Imported records are history, so readers are not notified, but summaries and versions reflect them */
+      summarize_live_records(_summaries, _summaries.find(specialtyid), specialtyid, patient_records_iter->details.find(specialtyid)->second,
+                             positions);
+      bump_chart_version(patient, specialtyid);
+   }
+}
+
+json_builder &serialize_records_to_json(json_builder &j_builder, const packed_record_row &packed_records,
+                                        const medical::tombstones &_tombstones, const std::map<uint8_t, std::string> &specialities_mapping)
+{
+   packed_records.for_each_specialty([&](const auto specialty_id, const auto &records) {
+      j_builder.add_key(specialities_mapping.find(specialty_id)->second).start_array();
+      const auto tombstoned = tombstoned_records(_tombstones, specialty_id);
+      for (size_t index = 0; index < records.size(); index++)
+      {
+         if (!is_tombstoned(tombstoned, index))
+            records[index].to_json(j_builder).complete_value_adding();
+      }
+      j_builder.undo_complete_value_adding().end_array().complete_value_adding();
+   });
+   return j_builder.undo_complete_value_adding();
+}
+
+void medical::recordstab(const eosio::name patient, uint64_t knownversion)
+{
+   /* Signature check, only patient is able to see all of his records */
+   require_auth(patient);
+
+   /* 
+      Answer only with version if client's copy of the chart is up to date, without loading records
+      Clients which keep no copies get the specialty keyed records alone
+   */
+   json_builder j_builder;
+   const auto is_versioned = knownversion != 0;
+   if (is_versioned)
+   {
+      if (add_chart_version(j_builder, chart_version(patient), knownversion))
+      {
+         eosio::print(j_builder.build().c_str());
+         return;
+      }
+      j_builder.add_key("records").start_object();
+   }
+
+   /* 
+      Check if this account is registered as patient by loading his records table
+      This works because:
+         1) only patiens can have records
+         2) at registration for every patient is created a table entry scopped with his account name
+         3) doctors can't be registered as patient and doctor at the same time
+   */
+   packed_record_row packed_records{};
+   eosio_assert(packed_records.load(get_self(), record::TABLE_NAME, patient), "you are not a registered patient");
+
+   /* Serialize and display all records, except the removed ones */
+   tombstones _tombstones{get_self(), patient.value};
+   serialize_records_to_json(j_builder, packed_records, _tombstones,
+                             _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet").mapping);
+   if (is_versioned)
+      j_builder.end_object();
+   eosio::print(j_builder.build().c_str());
+}
+
+void medical::removerecord(eosio::name patient, uint8_t specialtyid, std::string hash)
+{
+   /* Only contract is allowed to do this action */
+   require_auth(get_self());
+
+   /* Patient account validity check */
+   eosio_assert(is_account(patient), "this account doesn't exists");
+
+   /* Specialty id validity check */
+   const auto &speciality = _specialities_singleton.get(specialty::SINGLETON_ID, "Specilities nomenclature were not set yet");
+   eosio_assert(speciality.mapping.find(specialtyid) != speciality.mapping.end(), "speciality id is not valid");
+
+   /* Patient registration check */
+   records _records{get_self(), patient.value};
+   const auto &patient_records_iter = _records.find(patient.value);
+   eosio_assert(patient_records_iter != _records.end(), "this patient doesn't have any records");
+
+   /* Specialty records existence check */
+   const auto &specialty_records_iter = patient_records_iter->details.find(specialtyid);
+   eosio_assert(specialty_records_iter != patient_records_iter->details.end(), "this patient has no records for this specialty");
+
+   /* Record existence check, records which already have a tombstone were removed before */
+   tombstones _tombstones{get_self(), patient.value};
+   const auto &records = specialty_records_iter->second;
+   auto tombstoned = tombstoned_records(_tombstones, specialtyid);
+   auto index = records.size();
+   for (size_t i = 0; i < records.size(); i++)
+   {
+      if (records[i].hash == hash && !is_tombstoned(tombstoned, i))
+      {
+         index = i;
+         break;
+      }
+   }
+   eosio_assert(index != records.size(), "this record doesn't exist");
+   unindex_authored_record(records[index].doctor, patient, specialtyid, records[index].timestamp, hash);
+
+   /* Remove record by writing its tombstone, records row is rewritten later by compaction */
+   _tombstones.emplace(get_self(), [index, specialtyid](auto &entry) {
+      entry.id = tombstone::make_id(specialtyid, index);
+   });
+   tombstoned.insert(std::upper_bound(tombstoned.begin(), tombstoned.end(), index), index);
+   summarize_removed_record(patient, specialtyid, records, tombstoned);
+   bump_chart_version(patient, specialtyid);
+   schedule_compaction(patient);
+}
+
+void medical::compact(eosio::name patient, uint32_t limit)
+{
+   /* Only contract is allowed to do this action */
+   require_auth(get_self());
+
+   eosio_assert(limit != 0, "limit must be greater than 0");
+
+   /*
+      Take up to limit tombstones from the highest position down, so that erasing their records doesn't shift
+      positions of the tombstones left for the next batch
+   */
+   tombstones _tombstones{get_self(), patient.value};
+   arena_map<uint8_t, arena_vector<uint32_t>> compacted{};
+   auto tombstone_iter = _tombstones.end();
+   uint32_t taken = 0;
+   while (tombstone_iter != _tombstones.begin() && taken < limit)
+   {
+      --tombstone_iter;
+      compacted[tombstone_iter->specialtyid()].push_back(tombstone_iter->position());
+      taken++;
+   }
+
+   if (taken != 0)
+   {
+      /* Erase records of all taken tombstones with a single rewrite of records row */
+      records _records{get_self(), patient.value};
+      const auto patient_records_iter = _records.find(patient.value);
+      eosio_assert(patient_records_iter != _records.end(), "this patient doesn't have any records");
+      _records.modify(patient_records_iter, get_self(), [&compacted](auto &record) {
+         for (auto &[specialtyid, positions] : compacted)
+         {
+            std::reverse(positions.begin(), positions.end());
+            remove_positions(record.details[specialtyid], positions);
+         }
+      });
+
+      while (tombstone_iter != _tombstones.end())
+         tombstone_iter = _tombstones.erase(tombstone_iter);
+   }
+
+   /* Records visible to readers didn't change, so summaries and chart versions stay the same */
+   const auto completed = _tombstones.begin() == _tombstones.end();
+   if (!completed)
+      schedule_compaction(patient);
+
+   eosio::print(json_builder{}
+                    .add_key("compacted")
+                    .add_value(taken)
+                    .complete_value_adding()
+                    .add_key("completed")
+                    .add_value(completed ? "true" : "false")
+                    .build()
+                    .c_str());
+}
+
+void medical::register_account(eosio::name account, uint8_t kind)
+{
+   registry _registry{get_self(), get_self().value};
+   const auto account_iter = _registry.find(account.value);
+   if (account_iter == _registry.end())
+   {
+      /* New accounts have no rows in older layouts */
+      _registry.emplace(get_self(), [&](auto &entry) {
+         entry.account = account;
+         entry.kind = kind;
+         entry.version = schema::CURRENT_VERSION;
+      });
+   }
+   else
+   {
+      _registry.modify(account_iter, get_self(), [kind](auto &entry) {
+         entry.kind |= kind;
+      });
+   }
+}
+
+void medical::unregister_account(eosio::name account, uint8_t kind)
+{
+   registry _registry{get_self(), get_self().value};
+   const auto account_iter = _registry.find(account.value);
+   if (account_iter == _registry.end())
+      return;
+
+   if ((account_iter->kind & ~kind) == 0)
+   {
+      _registry.erase(account_iter);
+   }
+   else
+   {
+      _registry.modify(account_iter, get_self(), [kind](auto &entry) {
+         entry.kind &= ~kind;
+      });
+   }
+}
+
+uint32_t medical::account_version(eosio::name account)
+{
+   /* Accounts missing from registry were registered before schema versioning, so their rows have baseline layout */
+   registry _registry{get_self(), get_self().value};
+   const auto account_iter = _registry.find(account.value);
+   return account_iter == _registry.end() ? schema::BASELINE_VERSION : account_iter->version;
+}
+
+uint32_t medical::migrate_account(const account &entry)
+{
+   /* Every step converts all rows scoped by account from version to version + 1 in this action */
+   auto version = entry.version;
+   while (version < schema::CURRENT_VERSION)
+   {
+      switch (version)
+      {
+      case schema::SUMMARIES_VERSION - 1:
+         if (entry.kind & account::PATIENT)
+            build_record_summaries(entry.account);
+         break;
+
+      case schema::AUDIT_VERSION - 1:
+         if (entry.kind & account::PATIENT)
+            index_patient_records(entry.account);
+         break;
+
+      case schema::KEYS_VERSION - 1:
+         rewrite_account_keys(entry);
+         break;
+
+      case schema::PERMISSIONS_VERSION - 1:
+         if (entry.kind & account::PATIENT)
+            index_patient_permissions(entry.account, get_self());
+         break;
+
+      default:
+         eosio_assert(false, "there is no migration step for this schema version");
+      }
+      version++;
+   }
+   return version;
+}
+
+void medical::build_record_summaries(eosio::name patient)
+{
+   records _records{get_self(), patient.value};
+   const auto patient_records_iter = _records.find(patient.value);
+   if (patient_records_iter == _records.end())
+      return;
+
+   /* Summaries written before migration may be partial, so they are rebuilt from scratch */
+   summaries _summaries{get_self(), patient.value};
+   tombstones _tombstones{get_self(), patient.value};
+   for (const auto &[specialtyid, records] : patient_records_iter->details)
+      summarize_live_records(_summaries, _summaries.find(specialtyid), specialtyid, records, tombstoned_records(_tombstones, specialtyid));
+}
+
+void medical::index_patient_records(eosio::name patient)
+{
+   records _records{get_self(), patient.value};
+   const auto patient_records_iter = _records.find(patient.value);
+   if (patient_records_iter == _records.end())
+      return;
+
+   /*
+      Records written after index was introduced are already indexed, so identical records, written by the same doctor
+      at the same second, are counted and only the entries missing for them are added
+   */
+   tombstones _tombstones{get_self(), patient.value};
+   for (const auto &[specialtyid, records] : patient_records_iter->details)
+   {
+      const auto tombstoned = tombstoned_records(_tombstones, specialtyid);
+      for (size_t index = 0; index < records.size(); index++)
+      {
+         if (is_tombstoned(tombstoned, index))
+            continue;
+         const auto &record = records[index];
+         /* Records are in ascending order of timestamps, so identical ones precede this one directly */
+         uint32_t preceding = 0;
+         for (auto other = index; other > 0 && records[other - 1].timestamp == record.timestamp; other--)
+         {
+            const auto &other_record = records[other - 1];
+            if (!is_tombstoned(tombstoned, other - 1) && other_record.doctor == record.doctor && other_record.hash == record.hash)
+               preceding++;
+         }
+         if (count_authored_records(record.doctor, patient, specialtyid, record.timestamp, record.hash) <= preceding)
+            index_authored_record(record.doctor, patient, specialtyid, record.timestamp, record.hash);
+      }
+   }
+}
+
+void medical::rewrite_account_keys(const account &entry)
+{
+   /* Rows are rewritten only if some of their keys were stored as text, keys which can't be decoded are kept as they are */
+   if (entry.kind & account::PATIENT)
+   {
+      patients _patients{get_self(), entry.account.value};
+      const auto patient_iter = _patients.find(entry.account.value);
+      if (patient_iter != _patients.end())
+      {
+         auto pubenckey = patient_iter->pubenckey;
+         if (keys::convert_stored(pubenckey))
+         {
+            _patients.modify(patient_iter, eosio::same_payer, [&pubenckey](auto &patient) {
+               patient.pubenckey = std::move(pubenckey);
+            });
+         }
+      }
+   }
+   if (entry.kind & account::DOCTOR)
+   {
+      doctors _doctors{get_self(), entry.account.value};
+      const auto doctor_iter = _doctors.find(entry.account.value);
+      if (doctor_iter != _doctors.end())
+      {
+         auto converted = *doctor_iter;
+         auto changed = keys::convert_stored(converted.pubenckey);
+         for (auto &[patient, key] : converted.grantedkeys)
+            changed |= keys::convert_stored(key);
+         if (changed)
+         {
+            _doctors.modify(doctor_iter, eosio::same_payer, [&converted](auto &doctor) {
+               doctor = std::move(converted);
+            });
+         }
+      }
+   }
+   if (entry.kind & account::GROUP)
+   {
+      groups _groups{get_self(), get_self().value};
+      const auto group_iter = _groups.find(entry.account.value);
+      if (group_iter != _groups.end())
+      {
+         auto pubenckey = group_iter->pubenckey;
+         if (keys::convert_stored(pubenckey))
+         {
+            _groups.modify(group_iter, eosio::same_payer, [&pubenckey](auto &group) {
+               group.pubenckey = std::move(pubenckey);
+            });
+         }
+      }
+      groupkeys _groupkeys{get_self(), entry.account.value};
+      for (auto groupkey_iter = _groupkeys.begin(); groupkey_iter != _groupkeys.end(); ++groupkey_iter)
+      {
+         auto key = groupkey_iter->key;
+         if (keys::convert_stored(key))
+         {
+            _groupkeys.modify(groupkey_iter, eosio::same_payer, [&key](auto &groupkey) {
+               groupkey.key = std::move(key);
+            });
+         }
+      }
+   }
+}
+
+void medical::index_patient_permissions(eosio::name patient, eosio::name payer)
+{
+   patients _patients{get_self(), patient.value};
+   const auto patient_iter = _patients.find(patient.value);
+   if (patient_iter == _patients.end())
+      return;
+
+   /* Permissions added after index was introduced are already indexed, indexing is idempotent for them */
+   permissions _permissions{get_self(), patient.value};
+   for (const auto &[grantee, permids] : patient_iter->perms)
+   {
+      for (const auto permid : permids)
+         index_permission(patient, grantee, permid, _permissions.get(permid, "permission of patient is missing").specialtyids, payer);
+   }
+}
+
+void medical::index_permission(eosio::name patient, eosio::name grantee, uint64_t permid, const std::vector<uint8_t> &specialtyids, eosio::name payer)
+{
+   specperms _specperms{get_self(), patient.value};
+   for (const auto specialtyid : specialtyids)
+   {
+      const auto id = specperm::make_id(specialtyid, permid);
+      if (_specperms.find(id) == _specperms.end())
+      {
+         _specperms.emplace(payer, [id, grantee](auto &entry) {
+            entry.id = id;
+            entry.grantee = grantee;
+         });
+      }
+   }
+}
+
+void medical::unindex_permission(eosio::name patient, uint64_t permid, const std::vector<uint8_t> &specialtyids)
+{
+   /* Permissions of patients which were not migrated yet may be missing from index */
+   specperms _specperms{get_self(), patient.value};
+   for (const auto specialtyid : specialtyids)
+   {
+      if (const auto specperm_iter = _specperms.find(specperm::make_id(specialtyid, permid)); specperm_iter != _specperms.end())
+         _specperms.erase(specperm_iter);
+   }
+}
+
+void medical::index_authored_record(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash)
+{
+   /*
+      Records written by doctor at the same second are few, so the next sequence is found by walking them
+      Every record gets its own entry, even if an identical one was written at the same second
+   */
+   authoredrecs _authoredrecs{get_self(), doctor.value};
+   uint32_t sequence = 0;
+   for (auto authored_iter = _authoredrecs.lower_bound(authoredrec::make_id(timestamp, 0));
+        authored_iter != _authoredrecs.end() && authored_iter->timestamp() == timestamp; ++authored_iter)
+   {
+      sequence = static_cast<uint32_t>(authored_iter->id) + 1;
+   }
+
+   _authoredrecs.emplace(get_self(), [&](auto &entry) {
+      entry.id = authoredrec::make_id(timestamp, sequence);
+      entry.patient = patient;
+      entry.specialtyid = specialtyid;
+      entry.hash = hash;
+   });
+}
+
+uint32_t medical::count_authored_records(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash)
+{
+   authoredrecs _authoredrecs{get_self(), doctor.value};
+   uint32_t count = 0;
+   for (auto authored_iter = _authoredrecs.lower_bound(authoredrec::make_id(timestamp, 0));
+        authored_iter != _authoredrecs.end() && authored_iter->timestamp() == timestamp; ++authored_iter)
+   {
+      if (authored_iter->patient == patient && authored_iter->specialtyid == specialtyid && authored_iter->hash == hash)
+         count++;
+   }
+   return count;
+}
+
+void medical::unindex_authored_record(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash)
+{
+   /* Identical records share the same entries, so removing one of them erases only one entry */
+   authoredrecs _authoredrecs{get_self(), doctor.value};
+   for (auto authored_iter = _authoredrecs.lower_bound(authoredrec::make_id(timestamp, 0));
+        authored_iter != _authoredrecs.end() && authored_iter->timestamp() == timestamp; ++authored_iter)
+   {
+      if (authored_iter->patient == patient && authored_iter->specialtyid == specialtyid && authored_iter->hash == hash)
+      {
+         _authoredrecs.erase(authored_iter);
+         return;
+      }
+   }
+}
+
+void medical::setshards(const std::vector<eosio::name> &shards)
+{
+   /* Only contract is allowed to do this action, every shard is configured with the same list */
+   require_auth(get_self());
+
+   shardconfigs _shardconfigs{get_self(), get_self().value};
+   const auto config_iter = _shardconfigs.find(shardconfig::SINGLETON_ID);
+
+   /* Empty list switches back to single contract deployment */
+   if (shards.empty())
+   {
+      if (config_iter != _shardconfigs.end())
+         _shardconfigs.erase(config_iter);
+      return;
+   }
+
+   /* Shards validity check */
+   eosio_assert(std::find(shards.begin(), shards.end(), get_self()) != shards.end(), "this contract must be one of the shards");
+   arena_vector<eosio::name> sorted_shards{shards.begin(), shards.end()};
+   std::sort(sorted_shards.begin(), sorted_shards.end());
+   eosio_assert(std::adjacent_find(sorted_shards.begin(), sorted_shards.end()) == sorted_shards.end(), "all shards must be unique");
+   for (const auto shard : shards)
+      eosio_assert(is_account(shard), "shard account does not exist");
+
+   /*
+      Rows of a patient can't be moved to another shard, so the list can change only if every patient registered on
+      this shard stays assigned to it. Patients are found through accounts registry, patients registered before schema
+      versioning must be enlisted by regaccounts first
+   */
+   registry _registry{get_self(), get_self().value};
+   for (const auto &entry : _registry)
+   {
+      if (entry.kind & account::PATIENT)
+         eosio_assert(shards[sharding::shard_of(entry.account.value, shards.size())] == get_self(), "registered patients would be assigned to another shard");
+   }
+
+   const auto updater = [&shards](auto &config) {
+      config.id = shardconfig::SINGLETON_ID;
+      config.shards = shards;
+   };
+   if (config_iter == _shardconfigs.end())
+      _shardconfigs.emplace(get_self(), updater);
+   else
+      _shardconfigs.modify(config_iter, get_self(), updater);
+}
+
+void medical::mirror(const std::vector<eosio::name> &accounts)
+{
+   /* Only contract is allowed to do this action */
+   require_auth(get_self());
+
+   shardconfigs _shardconfigs{get_self(), get_self().value};
+   eosio_assert(_shardconfigs.find(shardconfig::SINGLETON_ID) != _shardconfigs.end(), "shards were not set yet");
+
+   /*
+      Doctors and groups registered before shards were set exist only on this shard, so they are forwarded as if they
+      were upserted now. Doctors go first, so that forwarded memberships find members of groups already mirrored;
+      members which are not among accounts must have been mirrored before
+      Accounts whose keys are still stored as text can't be forwarded, they are skipped without failing the others and
+      get mirrored once they upsert their key again
+   */
+   arena_set<eosio::name> skipped{};
+   for (const auto account_name : accounts)
+   {
+      doctors _doctors{get_self(), account_name.value};
+      const auto doctor_iter = _doctors.find(account_name.value);
+      if (doctor_iter == _doctors.end())
+      {
+         eosio_assert(is_group(account_name), "account is neither doctor nor group");
+         continue;
+      }
+      if (!keys::is_binary(doctor_iter->pubenckey))
+      {
+         skipped.insert(account_name);
+         continue;
+      }
+      forward_to_shards(eosio::name{"upsertdoc"}, std::make_tuple(doctor_iter->account, doctor_iter->specialtyid, keys::encode_text(doctor_iter->pubenckey)));
+   }
+
+   groups _groups{get_self(), get_self().value};
+   for (const auto account_name : accounts)
+   {
+      const auto group_iter = _groups.find(account_name.value);
+      if (group_iter == _groups.end())
+         continue;
+      if (!keys::is_binary(group_iter->pubenckey))
+      {
+         skipped.insert(account_name);
+         continue;
+      }
+      forward_to_shards(eosio::name{"upsertgroup"}, std::make_tuple(group_iter->id, group_iter->institution, keys::encode_text(group_iter->pubenckey)));
+      for (const auto member : group_iter->members)
+      {
+         if (skipped.find(member) == skipped.end())
+            forward_to_shards(eosio::name{"addmember"}, std::make_tuple(group_iter->id, member));
+      }
+   }
+
+   json_builder j_builder;
+   j_builder.add_key("skipped").start_array();
+   for (const auto account_name : skipped)
+      j_builder.add_string_value(account_name.to_string()).complete_value_adding();
+   eosio::print(j_builder.undo_complete_value_adding().end_array().build().c_str());
+}
+
+void medical::regaccounts(const std::vector<eosio::name> &accounts)
+{
+   /* Only contract is allowed to do this action */
+   require_auth(get_self());
+
+   registry _registry{get_self(), get_self().value};
+   auto enlisted = false;
+   for (const auto account_name : accounts)
+   {
+      /* Already registered accounts are left untouched */
+      if (_registry.find(account_name.value) != _registry.end())
+         continue;
+
+      /* Detect account kind from the rows it has */
+      uint8_t kind = 0;
+      if (patients _patients{get_self(), account_name.value}; _patients.find(account_name.value) != _patients.end())
+         kind |= account::PATIENT;
+      if (doctors _doctors{get_self(), account_name.value}; _doctors.find(account_name.value) != _doctors.end())
+         kind |= account::DOCTOR;
+      if (is_group(account_name))
+         kind |= account::GROUP;
+      eosio_assert(kind != 0, "account is neither patient, doctor nor group");
+
+      /* Accounts which were not registered yet hold rows with baseline layout */
+      _registry.emplace(get_self(), [&](auto &entry) {
+         entry.account = account_name;
+         entry.kind = kind;
+         entry.version = schema::BASELINE_VERSION;
+      });
+      enlisted = true;
+   }
+
+   /* Restart migration pass, already migrated accounts are skipped */
+   schema_table _schema{get_self(), get_self().value};
+   if (const auto schema_iter = _schema.find(schema::SINGLETON_ID); enlisted && schema_iter != _schema.end())
+   {
+      _schema.modify(schema_iter, get_self(), [](auto &schema) {
+         schema.version = schema::BASELINE_VERSION;
+         schema.cursor = 0;
+      });
+   }
+}
+
+void medical::migrate(uint32_t limit)
+{
+   /* Only contract is allowed to do this action */
+   require_auth(get_self());
+
+   eosio_assert(limit != 0, "limit must be greater than 0");
+
+   /* Load migration state, first call begins with baseline layout */
+   schema_table _schema{get_self(), get_self().value};
+   auto schema_iter = _schema.find(schema::SINGLETON_ID);
+   if (schema_iter == _schema.end())
+   {
+      schema_iter = _schema.emplace(get_self(), [](auto &schema) {
+         schema.id = schema::SINGLETON_ID;
+         schema.version = schema::BASELINE_VERSION;
+         schema.target = schema::CURRENT_VERSION;
+         schema.cursor = 0;
+      });
+   }
+   /* Contract code was upgraded since last pass, begin a new one */
+   if (schema_iter->target != schema::CURRENT_VERSION)
+   {
+      _schema.modify(schema_iter, get_self(), [](auto &schema) {
+         schema.target = schema::CURRENT_VERSION;
+         schema.cursor = 0;
+      });
+   }
+
+   /* Visit up to limit accounts starting from persisted cursor */
+   registry _registry{get_self(), get_self().value};
+   auto account_iter = _registry.lower_bound(schema_iter->cursor);
+   uint32_t visited = 0;
+   uint32_t migrated = 0;
+   for (; account_iter != _registry.end() && visited < limit; ++account_iter, ++visited)
+   {
+      if (account_iter->version >= schema::CURRENT_VERSION)
+         continue;
+      const auto version = migrate_account(*account_iter);
+      _registry.modify(account_iter, get_self(), [version](auto &entry) {
+         entry.version = version;
+      });
+      migrated++;
+   }
+
+   /* Persist cursor, or mark migration completed when whole registry was walked */
+   const auto completed = account_iter == _registry.end();
+   _schema.modify(schema_iter, get_self(), [&](auto &schema) {
+      schema.cursor = completed ? 0 : account_iter->account.value;
+      if (completed)
+         schema.version = schema::CURRENT_VERSION;
+   });
+
+   eosio::print(json_builder{}
+                    .add_key("migrated")
+                    .add_value(migrated)
+                    .complete_value_adding()
+                    .add_key("completed")
+                    .add_value(completed ? "true" : "false")
+                    .build()
+                    .c_str());
 }
 
 bool medical::right::isRightInValidRange(const uint8_t right) noexcept
@@ -892,4 +2867,4 @@ bool medical::right::isRightInValidRange(const uint8_t right) noexcept
    }
 }
 
-EOSIO_DISPATCH(medical, (loadrights)(begloaddspcs)(fnshloadspcs)(upsertpat)(rmpatient)(upsertdoc)(rmdoctor)(addperm)(updtperm)(rmperm)(readrecords)(writerecord)(removerecord)(recordstab))
\ No newline at end of file
+EOSIO_DISPATCH(medical, (loadrights)(begloaddspcs)(fnshloadspcs)(upsertpat)(rmpatient)(upsertdoc)(rmdoctor)(addperm)(updtperm)(rmperm)(revokespec)(rotatekey)(readrecords)(readbatch)(timeline)(writerecord)(importrecs)(removerecord)(compact)(recordstab)(pollinbox)(mypatients)(accesslog)(auditdoc)(upsertgroup)(rmgroup)(addmember)(rmmember)(setshards)(mirror)(regaccounts)(migrate))
\ No newline at end of file
@@ -4,6 +4,11 @@
 #include <map>
 #include <vector>
 #include <string_view>
+#include "access.hpp"
+#include "arena.hpp"
+#include "keys.hpp"
+#include "packed_records.hpp"
+#include "sharding.hpp"
 
 #define JSON_KEY_STR(key) "\"" #key "\":"
 
@@ -21,12 +26,26 @@ struct json_builder
       return *this;
    }
 
+   json_builder &add_key(const uint64_t key)
+   {
+      m_json += '"';
+      append_number(key);
+      m_json += "\":";
+      return *this;
+   }
+
    json_builder &add_value(const std::string_view value)
    {
       m_json += value;
       return *this;
    }
 
+   json_builder &add_value(const uint64_t value)
+   {
+      append_number(value);
+      return *this;
+   }
+
    json_builder &add_string_value(const std::string_view value)
    {
       m_json += '"';
@@ -47,6 +66,18 @@ struct json_builder
       return *this;
    }
 
+   json_builder &start_object()
+   {
+      m_json += '{';
+      return *this;
+   }
+
+   json_builder &end_object()
+   {
+      m_json += '}';
+      return *this;
+   }
+
    json_builder &complete_value_adding()
    {
       m_json += ',';
@@ -72,7 +103,21 @@ struct json_builder
    }
 
 private:
-   std::string m_json;
+   /* Writes decimal digits directly into the JSON, without temporary strings */
+   void append_number(uint64_t value)
+   {
+      char digits[20];
+      auto length = 0;
+      do
+      {
+         digits[length++] = '0' + value % 10;
+         value /= 10;
+      } while (value != 0);
+      while (length != 0)
+         m_json += digits[--length];
+   }
+
+   arena_string m_json;
 };
 
 class[[eosio::contract("medical")]] medical : public eosio::contract
@@ -137,9 +182,38 @@ public:
    struct perm_info
    {
       eosio::name patient;
+      /* Doctor account or name of a group of doctors */
       eosio::name doctor;
    };
 
+   struct read_request
+   {
+      eosio::name patient;
+      std::vector<uint8_t> specialtyids;
+      medical::interval interval;
+      /* Version of client's copy, 0 or chartversion::NO_COPY if there is none */
+      uint64_t knownversion;
+   };
+
+   struct granted_key
+   {
+      /* Doctor account or group name */
+      eosio::name grantee;
+      /* Record encription/decription AES key encrypted with grantee public key */
+      std::string key;
+   };
+
+   struct import_record
+   {
+      uint8_t specialtyid;
+      /* Time the record was originally written, records of a batch can come in any order */
+      uint32_t timestamp;
+      std::string hash;
+      /* Account of the doctor which wrote the record, who doesn't have to be registered as doctor */
+      eosio::name doctor;
+      std::string description;
+   };
+
    struct record_info
    {
       std::string hash;
@@ -152,26 +226,6 @@ public:
       std::string hash;
       eosio::name doctor;
       std::string description;
-
-      const auto to_json() const
-      {
-         return json_builder{}
-             .add_key("timestamp")
-             .add_value(std::to_string(timestamp))
-             .complete_value_adding()
-             .add_key("hash")
-             .add_string_value(hash)
-             .complete_value_adding()
-             .add_key("doctor")
-             .add_string_value(doctor.to_string())
-             .complete_value_adding()
-             .add_key("description")
-             .add_string_value(description)
-             .build();
-      }
-
-      friend bool operator==(uint32_t other_timestamp, const recordetails &record) noexcept { return other_timestamp == record.timestamp; }
-      friend bool operator<(uint32_t other_timestamp, const recordetails &record) noexcept { return other_timestamp < record.timestamp; }
    };
 
    ACTION loadrights();
@@ -187,11 +241,32 @@ public:
    ACTION addperm(const perm_info &perm, std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval, std::string &decreckey);
    ACTION updtperm(const perm_info &perm, uint64_t permid, std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval);
    ACTION rmperm(const perm_info &perm, uint64_t permid);
+   ACTION revokespec(eosio::name patient, uint8_t specialtyid);
+   ACTION rotatekey(eosio::name patient, std::vector<granted_key> & keys);
 
    ACTION writerecord(const perm_info &perm, uint8_t specialtyid, record_info &recordinfo);
-   ACTION readrecords(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval);
-   ACTION recordstab(const eosio::name patient);
+   ACTION importrecs(eosio::name patient, std::vector<import_record> & batch);
+   ACTION readrecords(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval, uint64_t knownversion);
+   ACTION readbatch(eosio::name doctor, const std::vector<read_request> &requests);
+   ACTION timeline(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval, uint32_t limit);
+   ACTION recordstab(const eosio::name patient, uint64_t knownversion);
+   ACTION pollinbox(eosio::name doctor, uint64_t since);
+   ACTION mypatients(eosio::name doctor);
+   ACTION accesslog(eosio::name patient, uint32_t count);
+   ACTION auditdoc(eosio::name doctor, const interval &interval, uint64_t cursor, uint32_t limit);
    ACTION removerecord(eosio::name patient, uint8_t specialtyid, std::string hash);
+   ACTION compact(eosio::name patient, uint32_t limit);
+
+   ACTION upsertgroup(eosio::name group, eosio::name institution, std::string & pubenckey);
+   ACTION rmgroup(eosio::name group);
+   ACTION addmember(eosio::name group, eosio::name doctor);
+   ACTION rmmember(eosio::name group, eosio::name doctor);
+
+   ACTION setshards(const std::vector<eosio::name> &shards);
+   ACTION mirror(const std::vector<eosio::name> &accounts);
+
+   ACTION regaccounts(const std::vector<eosio::name> &accounts);
+   ACTION migrate(uint32_t limit);
 
    TABLE right
    {
@@ -201,6 +276,9 @@ public:
          WRITE,
          READ_WRITE
       };
+      static_assert(access::bits_of(READ) == access::READ_BIT && access::bits_of(WRITE) == access::WRITE_BIT &&
+                        access::bits_of(READ_WRITE) == (access::READ_BIT | access::WRITE_BIT),
+                    "access engine relies on right ids order");
       static inline bool isRightInValidRange(const uint8_t right) noexcept;
       static inline bool are_rights_overlapped(const uint8_t _first, const uint8_t _second) noexcept
       {
@@ -241,12 +319,32 @@ public:
    };
    typedef eosio::multi_index<eosio::name{"permissions"}, permission> permissions;
 
+   /*
+      Index of patient permissions by granted specialty, scoped by patient account
+      Maintained by addperm, updtperm and rmperm, so that all permissions granting a specialty are found with a single
+      range scan, without walking permissions of every grantee
+   */
+   TABLE specperm
+   {
+      /* Specialty id in the upper byte, permission id in the rest */
+      uint64_t id;
+      /* Doctor account or name of a group of doctors holding the permission */
+      eosio::name grantee;
+
+      static uint64_t make_id(uint8_t specialtyid, uint64_t permid) noexcept { return static_cast<uint64_t>(specialtyid) << 56 | permid; }
+      uint8_t specialtyid() const noexcept { return static_cast<uint8_t>(id >> 56); }
+      uint64_t permid() const noexcept { return id & 0x00FFFFFFFFFFFFFF; }
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"specperms"}, specperm> specperms;
+
    TABLE patient
    {
       /* Patient account */
       eosio::name account;
-      /* Patient public encryption RSA-1024 key */
-      std::string pubenckey;
+      /* Patient public encryption key, DER encoded, in the stored format of keys.hpp */
+      std::vector<uint8_t> pubenckey;
       /* Account -> permission id's */
       std::map<eosio::name, std::vector<uint64_t>> perms;
 
@@ -263,6 +361,9 @@ public:
    */
    TABLE record
    {
+      /* Read actions load row through packed_record_row, by this table name */
+      static constexpr inline uint64_t TABLE_NAME = eosio::name{"records"}.value;
+
       /* Patient account */
       eosio::name patient;
       /* specialty -> record details */
@@ -272,26 +373,409 @@ public:
    };
    typedef eosio::multi_index<eosio::name{"records"}, record> records;
 
+   /*
+      Summary of patient records for each specialty, scoped by patient
+      Updated in O(1) on every record write and removal, so clients can decide whether to fetch records at all
+      and readrecords can skip specialties without loading patient records
+   */
+   TABLE recordsummary
+   {
+      /* Specialty id according to specialties table */
+      uint8_t specialtyid;
+      /* Number of records of this specialty */
+      uint32_t count;
+      /* Timestamp of the oldest record */
+      uint32_t first;
+      /* Timestamp of the newest record */
+      uint32_t last;
+      /* Doctor which wrote the newest record */
+      eosio::name lastwriter;
+
+      uint64_t primary_key() const noexcept { return specialtyid; }
+   };
+   typedef eosio::multi_index<eosio::name{"summaries"}, recordsummary> summaries;
+
+   /*
+      Versions of patient chart, scoped by patient
+      Bumped on every record write and removal, both for the specialty and the whole chart, so that read actions
+      can answer clients which already have an up to date copy without loading records
+      Clients see hashes of the counters an answer depends on, never the counters themselves. Known version 0 keeps
+      readrecords and recordstab answering with the bare specialty keyed records; any other known version makes them
+      answer with {"version","records"} or {"version","notmodified"}
+   */
+   TABLE chartversion
+   {
+      /* Key of the whole chart version, specialty versions are keyed by specialty id */
+      static constexpr inline uint64_t PATIENT_KEY = 256;
+      /* Known version of clients which have no copy yet, no answer has it or 0 as its version */
+      static constexpr inline uint64_t NO_COPY = 1;
+
+      /* Folds one more value, which an answer depends on, into the version of the answer */
+      static constexpr uint64_t fold(uint64_t answer_version, uint64_t value) noexcept
+      {
+         return sharding::mix(answer_version + value + 0x9E3779B97F4A7C15ULL);
+      }
+
+      static constexpr uint64_t seal(uint64_t answer_version) noexcept
+      {
+         return answer_version > NO_COPY ? answer_version : answer_version + NO_COPY + 1;
+      }
+
+      uint64_t key;
+      uint64_t version;
+
+      uint64_t primary_key() const noexcept { return key; }
+   };
+   typedef eosio::multi_index<eosio::name{"versions"}, chartversion> chartversions;
+
+   /*
+      Progress of patient record key rotation, scoped by patient
+      Exists only while rotation is in progress, so that rotation can be resumed across transactions
+   */
+   TABLE keyrotation
+   {
+      static constexpr inline uint64_t SINGLETON_ID = 0;
+
+      uint64_t id;
+      /* Last grantee which received rotated key, grantees are rotated in ascending order */
+      eosio::name cursor;
+      /* Number of grantees which received rotated key */
+      uint32_t rotated;
+      /* Number of grantees when rotation began; grantees added or removed since then invalidate the cursor */
+      uint32_t grantees;
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"rotations"}, keyrotation> keyrotations;
+
+   /*
+      Records removed from patient chart which are still present in records table, scoped by patient
+      Removal writes only a tombstone which reads skip, records are physically erased later by compact in batches,
+      so a burst of removals rewrites patient records row once per batch instead of once per removal
+   */
+   TABLE tombstone
+   {
+      /* Tombstones erased by one compaction */
+      static constexpr inline uint32_t COMPACTION_BATCH = 64;
+      /* Compaction runs once removals settle for this long */
+      static constexpr inline uint32_t COMPACTION_DELAY_SEC = 60;
+
+      /* Specialty id in the upper half, position of the record within specialty records in the lower half */
+      uint64_t id;
+
+      static uint64_t make_id(uint8_t specialtyid, uint32_t position) noexcept { return static_cast<uint64_t>(specialtyid) << 32 | position; }
+      uint8_t specialtyid() const noexcept { return static_cast<uint8_t>(id >> 32); }
+      uint32_t position() const noexcept { return static_cast<uint32_t>(id); }
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"tombstones"}, tombstone> tombstones;
+
+   /*
+      Index of records by authoring doctor, scoped by doctor account
+      Maintained by writerecord, importrecs and removerecord, so that auditing records written by a doctor in a period
+      is a range scan proportional to the result, instead of a scan over records of every patient
+      Every shard indexes only records of its own patients, auditdoc is run on each shard with a cursor of that shard
+   */
+   TABLE authoredrec
+   {
+      /* Record timestamp in the upper half, sequence of records written by doctor at the same second in the lower half */
+      uint64_t id;
+      eosio::name patient;
+      uint8_t specialtyid;
+      std::string hash;
+
+      static uint64_t make_id(uint32_t timestamp, uint32_t sequence) noexcept { return static_cast<uint64_t>(timestamp) << 32 | sequence; }
+      uint32_t timestamp() const noexcept { return static_cast<uint32_t>(id >> 32); }
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"authored"}, authoredrec> authoredrecs;
+
    TABLE doctor
    {
       /* Doctor account */
       eosio::name account;
       /* Doctor specialty according to specialties table */
       uint8_t specialtyid;
-      /* Doctor public key used to shared patient private record encryption key */
-      std::string pubenckey;
-      /* Granted record encription/decription AES keys from patients */
-      std::map<eosio::name, std::string> grantedkeys;
+      /* Doctor public key used to shared patient private record encryption key, DER encoded */
+      std::vector<uint8_t> pubenckey;
+      /* Granted record encription/decription AES keys from patients, encrypted with doctor public key */
+      std::map<eosio::name, std::vector<uint8_t>> grantedkeys;
 
       uint64_t primary_key() const noexcept { return account.value; }
    };
    typedef eosio::multi_index<eosio::name{"doctors"}, doctor> doctors;
 
+   /*
+      Reverse index of the patients which granted permissions to a doctor, scoped by doctor account
+      Maintained by addperm, updtperm, rmperm and revokespec, so that doctor's patients can be listed with a single range scan,
+      without loading granted AES keys from doctors table
+      Grants to a group are kept under group name, mypatients merges them with the own ones of every member doctor
+      Shards list only their own patients, so clients of a sharded deployment concatenate mypatients of all shards
+   */
+   TABLE docpatient
+   {
+      /* Patient account */
+      eosio::name patient;
+      /* Union of all rights granted by patient, according to rights table */
+      uint8_t right;
+      /*
+         Closest end of a limited permission interval which didn't expired yet when the row was updated, 0 if there is none
+         Limited READ permissions are not deleted on expiry, so it may lie in the past; mypatients then summarizes permissions again
+      */
+      uint32_t nextexpiry;
+
+      uint64_t primary_key() const noexcept { return patient.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"docpatients"}, docpatient> docpatients;
+
+   /*
+      Feed of records written for patients which granted READ to a doctor, scoped by doctor
+      Only pointers to records are kept, in a ring of CAPACITY slots, so RAM per doctor is bounded
+      pollinbox returns entries from sequence since onwards, clients pass back the next sequence of their previous poll
+      Sequences are counted by each shard on its own, so clients of a sharded deployment poll every shard with its own since
+   */
+   TABLE inboxentry
+   {
+      static constexpr inline uint64_t CAPACITY = 64;
+
+      /* Slot in the ring, which is sequence modulo capacity */
+      uint64_t slot;
+      /* Monotonic sequence number of the entry */
+      uint64_t sequence;
+      /* Patient the record was written for */
+      eosio::name patient;
+      /* Specialty id according to specialties table */
+      uint8_t specialtyid;
+      /* Record timestamp */
+      uint32_t timestamp;
+
+      uint64_t primary_key() const noexcept { return slot; }
+   };
+   typedef eosio::multi_index<eosio::name{"inbox"}, inboxentry> inbox;
+
+   /*
+      Ring buffer of reads of patient chart, scoped by patient
+      Every granted read appends an entry, overwriting the oldest one once ring is full, so RAM stays constant per patient
+   */
+   TABLE accessentry
+   {
+      static constexpr inline uint64_t CAPACITY = 128;
+
+      /* Slot in the ring, which is sequence modulo capacity */
+      uint64_t slot;
+      /* Monotonic sequence number of the entry */
+      uint64_t sequence;
+      /* Doctor which read the chart, or contract for BTGM reads */
+      eosio::name doctor;
+      /* Bitmap of read specialty ids, ids 0-127 in low half and 128-255 in high half */
+      uint128_t lowspecialties;
+      uint128_t highspecialties;
+      /* Requested interval of records */
+      medical::interval interval;
+      /* Time of the read */
+      uint32_t timestamp;
+
+      void add_specialty(uint8_t specialtyid) noexcept
+      {
+         (specialtyid < 128 ? lowspecialties : highspecialties) |= static_cast<uint128_t>(1) << (specialtyid % 128);
+      }
+      bool has_specialty(uint8_t specialtyid) const noexcept
+      {
+         return ((specialtyid < 128 ? lowspecialties : highspecialties) >> (specialtyid % 128)) & 1;
+      }
+
+      uint64_t primary_key() const noexcept { return slot; }
+   };
+   typedef eosio::multi_index<eosio::name{"accesses"}, accessentry> accesses;
+
+   /* Next sequence number of each ring owned by an account, scoped by ring owner */
+   TABLE ringhead
+   {
+      /* Ring table name */
+      eosio::name ring;
+      /* Sequence number of the next entry */
+      uint64_t next;
+
+      uint64_t primary_key() const noexcept { return ring.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"ringheads"}, ringhead> ringheads;
+
+   /*
+      Groups of doctors (e.g. a hospital ward), scoped by contract account
+      Patients grant permissions to a group by using group name in place of doctor account, so permissions
+      of a care team are stored once and team turnover is handled by the institution through membership
+   */
+   TABLE group
+   {
+      /* Group name, shares namespace with doctor accounts */
+      eosio::name id;
+      /* Account which manages group membership */
+      eosio::name institution;
+      /* Group public key used to share patient record encryption key with all members, DER encoded */
+      std::vector<uint8_t> pubenckey;
+      /* Member doctors */
+      std::vector<eosio::name> members;
+
+      uint64_t primary_key() const noexcept { return id.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"groups"}, group> groups;
+
+   /* Groups a doctor belongs to, scoped by doctor account */
+   TABLE membership
+   {
+      eosio::name group;
+
+      uint64_t primary_key() const noexcept { return group.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"memberships"}, membership> memberships;
+
+   /* Granted record encription/decription AES keys from patients, scoped by group */
+   TABLE groupkey
+   {
+      /* Patient account */
+      eosio::name patient;
+      /* Record key encrypted with group public key */
+      std::vector<uint8_t> key;
+
+      uint64_t primary_key() const noexcept { return patient.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"groupkeys"}, groupkey> groupkeys;
+
+   /*
+      Registry of patient, doctor and group accounts, scoped by contract account
+      Contract can't enumerate table scopes by itself, so migrations walk over this registry
+      Every account records the schema version of the rows scoped by it, so that reads and writes
+      can keep working while only a part of the accounts were migrated to the new layout
+   */
+   TABLE account
+   {
+      enum kind_enum : uint8_t
+      {
+         PATIENT = 1,
+         DOCTOR = 2,
+         GROUP = 4
+      };
+
+      /* Patient or doctor account, or group name */
+      eosio::name account;
+      /* Bitmask of kind_enum values */
+      uint8_t kind;
+      /* Layout version of rows scoped by this account */
+      uint32_t version;
+
+      uint64_t primary_key() const noexcept { return account.value; }
+   };
+   typedef eosio::multi_index<eosio::name{"registry"}, account> registry;
+
+   /*
+      Shards of a sharded deployment, scoped by contract
+      Patients are assigned to shards by sharding::shard_of over this list, doctors and groups are mirrored on every shard
+      Reads of patients of another shard fail with "this patient belongs to another shard", readbatch names that shard
+      Doctor scoped views (docpatients, inbox, authored records) hold only rows of patients of this shard
+      Doctors and groups registered before this list was set are copied to the other shards by mirror
+      List can change only while it keeps every registered patient on its shard, as patient rows can't be moved
+      Missing configuration means a single contract holds everything
+   */
+   TABLE shardconfig
+   {
+      static constexpr inline uint64_t SINGLETON_ID = 0;
+
+      uint64_t id;
+      /* Shard contract accounts, position in the list is the shard number */
+      std::vector<eosio::name> shards;
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"shards"}, shardconfig> shardconfigs;
+
+   TABLE schema
+   {
+      /* Layout of rows written before schema versioning was introduced */
+      static constexpr inline uint32_t BASELINE_VERSION = 1;
+      /* Patient record summaries are complete */
+      static constexpr inline uint32_t SUMMARIES_VERSION = 2;
+      /* Records of patient are indexed by authoring doctor */
+      static constexpr inline uint32_t AUDIT_VERSION = 3;
+      /* Encryption keys of patients, doctors and groups are stored binary instead of base64 text */
+      static constexpr inline uint32_t KEYS_VERSION = 4;
+      /* Permissions of patient are indexed by specialty */
+      static constexpr inline uint32_t PERMISSIONS_VERSION = 5;
+      /* Layout written by current contract code */
+      static constexpr inline uint32_t CURRENT_VERSION = PERMISSIONS_VERSION;
+      static constexpr inline uint64_t SINGLETON_ID = 0;
+
+      uint64_t id;
+      /* Version which all registered accounts were migrated to */
+      uint32_t version;
+      /* Version the migration in progress is converting to */
+      uint32_t target;
+      /* Account from which next migrate call resumes */
+      uint64_t cursor;
+
+      uint64_t primary_key() const noexcept { return id; }
+   };
+   typedef eosio::multi_index<eosio::name{"schema"}, schema> schema_table;
+
 private:
+   void inline check_permission_request(const std::vector<uint8_t> &specialtyids, uint8_t rightid, const interval &interval, uint32_t current_time);
    void inline schedule_for_deletion(const perm_info &perm, uint64_t permid, uint32_t current_time, uint32_t upper_interval);
-   void inline display_requested_record_hashes(const std::vector<uint8_t> &specialtyids, const interval &interval,
-                                               const std::map<uint8_t, std::vector<recordetails>> &record_details);
-
+   void inline register_account(eosio::name account, uint8_t kind);
+   void inline unregister_account(eosio::name account, uint8_t kind);
+   uint32_t inline account_version(eosio::name account);
+   uint32_t inline migrate_account(const account &entry);
+   void inline build_record_summaries(eosio::name patient);
+   void inline index_patient_records(eosio::name patient);
+   void inline rewrite_account_keys(const account &entry);
+   void inline index_patient_permissions(eosio::name patient, eosio::name payer);
+   void inline index_permission(eosio::name patient, eosio::name grantee, uint64_t permid, const std::vector<uint8_t> &specialtyids, eosio::name payer);
+   void inline unindex_permission(eosio::name patient, uint64_t permid, const std::vector<uint8_t> &specialtyids);
+   void inline index_authored_record(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash);
+   uint32_t inline count_authored_records(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash);
+   void inline unindex_authored_record(eosio::name doctor, eosio::name patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash);
+   eosio::name inline patient_shard(eosio::name patient);
+   bool inline is_local_patient(eosio::name patient);
+   bool inline is_forwarded_by_shard();
+   template <typename... Args>
+   void inline forward_to_shards(eosio::name action, const std::tuple<Args...> &args);
+   bool inline is_group(eosio::name grantee);
+   void inline revoke_grantee(eosio::name patient, eosio::name grantee);
+   arena_vector<eosio::name> inline doctor_groups(eosio::name doctor);
+   template <typename Visitor>
+   bool inline for_each_doctor_perms(const perm_info &perm, const std::map<eosio::name, std::vector<uint64_t>> &patient_perms,
+                                     const arena_vector<eosio::name> &doctor_groups, Visitor &&visitor);
+   void inline update_doctor_patients(const perm_info &perm, const std::map<eosio::name, std::vector<uint64_t>> &patient_perms,
+                                      const permissions &_permissions, uint32_t current_time);
+   std::pair<uint8_t, uint32_t> inline live_grants(const perm_info &perm, uint32_t current_time);
+   template <typename Ring, typename Writer>
+   uint64_t inline append_to_ring(Ring &ring, eosio::name ring_name, uint64_t capacity, eosio::name payer, Writer &&writer);
+   void inline notify_readers(const std::map<eosio::name, std::vector<uint64_t>> &patient_perms, const perm_info &perm,
+                              uint8_t specialtyid, uint32_t timestamp);
+   void inline log_access(const perm_info &perm, const arena_vector<uint8_t> &specialtyids, const interval &interval);
+   void inline summarize_written_record(eosio::name patient, uint8_t specialtyid, uint32_t timestamp, eosio::name writer);
+   void inline summarize_removed_record(eosio::name patient, uint8_t specialtyid, const std::vector<recordetails> &records,
+                                       const arena_vector<uint32_t> &tombstoned);
+   void inline summarize_live_records(summaries &_summaries, summaries::const_iterator summary_iter, uint8_t specialtyid,
+                                      const std::vector<recordetails> &records, const arena_vector<uint32_t> &tombstoned);
+   void inline schedule_compaction(eosio::name patient);
+   template <typename SpecialtyIds>
+   arena_vector<uint8_t> inline specialties_with_records_since(eosio::name patient, const SpecialtyIds &specialtyids, uint32_t from);
+   inline const char *check_read_request(const std::vector<uint8_t> &specialtyids, const interval &interval, const specialty &speciality);
+   inline const char *evaluate_read_request(const perm_info &perm, const std::vector<uint8_t> &specialtyids, const interval &interval,
+                                            const specialty &speciality, const arena_vector<eosio::name> &groups,
+                                            arena_vector<uint8_t> &readable_specialtyids);
+   template <typename SpecialtyIds>
+   inline json_builder &add_requested_records(json_builder &j_builder, const SpecialtyIds &specialtyids, const interval &interval,
+                                              const packed_record_row &packed_records, const tombstones &_tombstones);
+   void inline bump_chart_version(eosio::name patient, uint8_t specialtyid);
+   uint64_t inline chart_version(eosio::name patient);
+   template <typename SpecialtyIds>
+   uint64_t inline chart_version(eosio::name patient, const SpecialtyIds &specialtyids, const interval &interval);
+   bool inline add_chart_version(json_builder &j_builder, uint64_t version, uint64_t knownversion);
+
+   /* Transient allocations of this action are released when contract is destroyed */
+   action_arena::scope _arena_scope;
    rights_table _rigts_sigleton;
    specialties_table _specialities_singleton;
 };
@@ -0,0 +1,224 @@
+#pragma once
+#include <eosiolib/eosio.hpp>
+#include <cstring>
+#include <string_view>
+#include "arena.hpp"
+
+/*
+   Read only view of a row of records table, decoded in place from its packed bytes
+   Row is copied out of the database once and records are visited without deserializing the map of vectors, so read
+   actions don't allocate a string for every hash and description which they only copy into output.
+   Packed layout is the one of medical::record: patient name, varuint32 count of specialties, each of them a specialty id
+   and varuint32 count of records, each record an uint32 timestamp, hash, doctor name and description, strings being
+   prefixed with their varuint32 length
+*/
+class packed_record_row
+{
+public:
+   struct record_view
+   {
+      uint32_t timestamp;
+      std::string_view hash;
+      eosio::name doctor;
+      std::string_view description;
+
+      template <typename JsonBuilder>
+      JsonBuilder &to_json(JsonBuilder &j_builder) const
+      {
+         return j_builder.start_object()
+             .add_key("timestamp")
+             .add_value(timestamp)
+             .complete_value_adding()
+             .add_key("hash")
+             .add_string_value(hash)
+             .complete_value_adding()
+             .add_key("doctor")
+             .add_string_value(doctor.to_string())
+             .complete_value_adding()
+             .add_key("description")
+             .add_string_value(description)
+             .end_object();
+      }
+   };
+
+   /* Records of one specialty, in ascending order of timestamps */
+   class specialty_view
+   {
+   public:
+      specialty_view() noexcept = default;
+      specialty_view(const packed_record_row *row, uint32_t first, uint32_t count) noexcept : m_row{row}, m_first{first}, m_count{count}
+      {
+      }
+
+      size_t size() const noexcept { return m_count; }
+      bool empty() const noexcept { return m_count == 0; }
+
+      uint32_t timestamp(size_t index) const noexcept
+      {
+         uint32_t timestamp;
+         std::memcpy(&timestamp, m_row->record_bytes(m_first + index), sizeof(timestamp));
+         return timestamp;
+      }
+
+      record_view operator[](size_t index) const noexcept
+      {
+         auto position = m_row->record_bytes(m_first + index);
+         record_view record{};
+         std::memcpy(&record.timestamp, position, sizeof(record.timestamp));
+         position += sizeof(record.timestamp);
+         record.hash = read_string(position);
+         std::memcpy(&record.doctor.value, position, sizeof(record.doctor.value));
+         position += sizeof(record.doctor.value);
+         record.description = read_string(position);
+         return record;
+      }
+
+      /* Position of the first record not older than timestamp */
+      size_t lower_bound(uint32_t timestamp) const noexcept
+      {
+         return partition_point([this, timestamp](size_t index) { return this->timestamp(index) < timestamp; });
+      }
+
+      /* Position of the first record newer than timestamp */
+      size_t upper_bound(uint32_t timestamp) const noexcept
+      {
+         return partition_point([this, timestamp](size_t index) { return this->timestamp(index) <= timestamp; });
+      }
+
+   private:
+      template <typename Predicate>
+      size_t partition_point(Predicate &&is_before) const noexcept
+      {
+         size_t lower = 0, count = m_count;
+         while (count != 0)
+         {
+            const auto half = count / 2;
+            if (is_before(lower + half))
+            {
+               lower += half + 1;
+               count -= half + 1;
+            }
+            else
+            {
+               count = half;
+            }
+         }
+         return lower;
+      }
+
+      const packed_record_row *m_row = nullptr;
+      uint32_t m_first = 0;
+      uint32_t m_count = 0;
+   };
+
+   /* Loads row of patient from records table of code, returns false if patient has no row */
+   bool load(eosio::name code, uint64_t table, eosio::name patient)
+   {
+      const auto iterator = db_find_i64(code.value, patient.value, table, patient.value);
+      if (iterator < 0)
+         return false;
+      const auto size = db_get_i64(iterator, nullptr, 0);
+      m_bytes.resize(size);
+      db_get_i64(iterator, m_bytes.data(), size);
+      index();
+      return true;
+   }
+
+   specialty_view specialty(uint8_t specialtyid) const noexcept
+   {
+      for (const auto &entry : m_specialties)
+         if (entry.specialtyid == specialtyid)
+            return {this, entry.first, entry.count};
+      return {};
+   }
+
+   /* Visits specialties in ascending order of ids, as they are stored */
+   template <typename Visitor>
+   void for_each_specialty(Visitor &&visitor) const
+   {
+      for (const auto &entry : m_specialties)
+         visitor(entry.specialtyid, specialty_view{this, entry.first, entry.count});
+   }
+
+private:
+   struct specialty_entry
+   {
+      uint8_t specialtyid;
+      /* Range of record offsets */
+      uint32_t first;
+      uint32_t count;
+   };
+
+   static uint32_t read_varuint(const char *&position) noexcept
+   {
+      uint32_t value = 0;
+      uint8_t shift = 0;
+      uint8_t byte;
+      do
+      {
+         byte = static_cast<uint8_t>(*position++);
+         value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+         shift += 7;
+      } while ((byte & 0x80) != 0 && shift < 35);
+      return value;
+   }
+
+   static std::string_view read_string(const char *&position) noexcept
+   {
+      const auto length = read_varuint(position);
+      const std::string_view text{position, length};
+      position += length;
+      return text;
+   }
+
+   const char *record_bytes(size_t index) const noexcept
+   {
+      return m_bytes.data() + m_offsets[index];
+   }
+
+   /* Single pass over the row which records where every record starts, lengths are checked once here */
+   void index()
+   {
+      const char *begin = m_bytes.data();
+      const char *end = begin + m_bytes.size();
+      const auto require = [end](const char *position, size_t size) {
+         eosio_assert(position <= end && size <= static_cast<size_t>(end - position), "records row is malformed");
+      };
+      const auto skip_string = [&require](const char *&position) {
+         require(position, 1);
+         const auto length = read_varuint(position);
+         require(position, length);
+         position += length;
+      };
+
+      auto position = begin;
+      require(position, sizeof(uint64_t) + 1);
+      position += sizeof(uint64_t);
+      const auto specialties = read_varuint(position);
+      m_specialties.clear();
+      m_offsets.clear();
+      m_specialties.reserve(specialties);
+      for (uint32_t i = 0; i < specialties; i++)
+      {
+         require(position, 2);
+         const auto specialtyid = static_cast<uint8_t>(*position++);
+         const auto count = read_varuint(position);
+         m_specialties.push_back({specialtyid, static_cast<uint32_t>(m_offsets.size()), count});
+         for (uint32_t j = 0; j < count; j++)
+         {
+            m_offsets.push_back(static_cast<uint32_t>(position - begin));
+            require(position, sizeof(uint32_t));
+            position += sizeof(uint32_t);
+            skip_string(position);
+            require(position, sizeof(uint64_t));
+            position += sizeof(uint64_t);
+            skip_string(position);
+         }
+      }
+   }
+
+   arena_vector<char> m_bytes;
+   /* Offset of every record within row bytes, records of a specialty are adjacent */
+   arena_vector<uint32_t> m_offsets;
+   arena_vector<specialty_entry> m_specialties;
+};
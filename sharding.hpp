@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+/*
+   Assignment of patients to shard contracts
+   Kept free of eosiolib, so that off-chain routers compute the same shard as the contracts do
+*/
+namespace sharding
+{
+   /* Account names differ mostly in their high bits, so they are mixed before hashing */
+   constexpr uint64_t mix(uint64_t value) noexcept
+   {
+      value ^= value >> 30;
+      value *= 0xBF58476D1CE4E5B9ULL;
+      value ^= value >> 27;
+      value *= 0x94D049BB133111EBULL;
+      return value ^ (value >> 31);
+   }
+
+   /*
+      Jump consistent hash of account name
+      Appending a shard to a deployment of n shards moves only 1/(n + 1) of the patients, all of them to the new shard
+   */
+   constexpr uint32_t shard_of(uint64_t account, uint32_t shards_count) noexcept
+   {
+      auto key = mix(account);
+      int64_t bucket = -1;
+      int64_t jump = 0;
+      while (jump < static_cast<int64_t>(shards_count))
+      {
+         bucket = jump;
+         key = key * 2862933555777941757ULL + 1;
+         jump = static_cast<int64_t>((bucket + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+      }
+      return static_cast<uint32_t>(bucket);
+   }
+} // namespace sharding
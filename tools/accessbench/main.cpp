@@ -0,0 +1,208 @@
+#include "access.hpp"
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+   Microbenchmark of permission evaluation
+   Compares the specialized checks of access.hpp with the loops readrecords and writerecord used before,
+   over the same random permissions and requests, and verifies both give the same answers
+*/
+namespace
+{
+   enum right_enum : uint8_t
+   {
+      READ,
+      WRITE,
+      READ_WRITE
+   };
+
+   struct period
+   {
+      uint32_t from;
+      uint32_t to;
+   };
+
+   /* Fields of medical::permission the checks read */
+   struct permission
+   {
+      std::vector<uint8_t> specialtyids;
+      uint8_t right;
+      period interval;
+   };
+
+   struct read_request
+   {
+      std::vector<uint8_t> specialtyids;
+      period interval;
+   };
+
+   /* Read check as it was done by evaluate_read_request */
+   std::vector<uint8_t> legacy_read(const std::vector<permission> &permissions, const read_request &request)
+   {
+      auto number_of_specialties_satisfied = 0u;
+      const auto number_of_specialties_requested = request.specialtyids.size();
+      std::map<uint8_t, bool> satisfied_specialties;
+      for (const auto specialty_id : request.specialtyids)
+         satisfied_specialties[specialty_id] = false;
+
+      for (const auto &perm : permissions)
+      {
+         if (number_of_specialties_satisfied == number_of_specialties_requested)
+            break;
+         if ((perm.right == READ || perm.right == READ_WRITE) &&
+             ((perm.interval.from == 0 && perm.interval.to == 0) ||
+              (request.interval.from >= perm.interval.from && request.interval.to <= perm.interval.to)))
+         {
+            for (const auto &[specialty_id, is_satisfied] : satisfied_specialties)
+            {
+               if (!is_satisfied)
+               {
+                  const auto id = specialty_id;
+                  for (const auto granted : perm.specialtyids)
+                  {
+                     if (granted == id)
+                     {
+                        satisfied_specialties[id] = true;
+                        number_of_specialties_satisfied++;
+                        break;
+                     }
+                  }
+               }
+            }
+         }
+      }
+
+      std::vector<uint8_t> readable;
+      for (const auto &[specialty_id, is_satisfied] : satisfied_specialties)
+         if (is_satisfied)
+            readable.push_back(specialty_id);
+      return readable;
+   }
+
+   /* Read check of the access engine */
+   std::vector<uint8_t> engine_read(const std::vector<permission> &permissions, const read_request &request)
+   {
+      access::specialty_set requested{}, satisfied{};
+      for (const auto specialty_id : request.specialtyids)
+         requested.insert(specialty_id);
+      for (const auto &perm : permissions)
+      {
+         if (satisfied == requested)
+            break;
+         if (access::read_check::allows(perm, request.interval.from, request.interval.to))
+            satisfied.add_granted(perm.specialtyids, requested);
+      }
+
+      std::vector<uint8_t> readable;
+      satisfied.for_each([&readable](const auto specialty_id) { readable.push_back(specialty_id); });
+      return readable;
+   }
+
+   /* Write check as it was done by writerecord */
+   bool legacy_write(const std::vector<permission> &permissions, uint8_t specialtyid, uint32_t now)
+   {
+      for (const auto &perm : permissions)
+      {
+         if ((perm.right == WRITE || perm.right == READ_WRITE) && perm.specialtyids[0] == specialtyid &&
+             ((perm.interval.from == 0 && perm.interval.to == 0) || (now >= perm.interval.from && now <= perm.interval.to)))
+            return true;
+      }
+      return false;
+   }
+
+   bool engine_write(const std::vector<permission> &permissions, uint8_t specialtyid, uint32_t now)
+   {
+      for (const auto &perm : permissions)
+      {
+         if (access::write_check::allows_at(perm, now) & (perm.specialtyids[0] == specialtyid))
+            return true;
+      }
+      return false;
+   }
+
+   template <typename Function>
+   double measure(Function &&function)
+   {
+      const auto started = std::chrono::steady_clock::now();
+      function();
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+   }
+} // namespace
+
+int main(int argc, char **argv)
+{
+   const auto permissions_count = argc > 1 ? std::stoul(argv[1]) : 16ul;
+   const auto iterations = argc > 2 ? std::stoul(argv[2]) : 200000ul;
+
+   /* Patients grant a few permissions to a doctor, with intervals around a fixed moment */
+   std::mt19937 random{42};
+   const uint32_t now = 1600000000;
+   const auto random_interval = [&]() -> period {
+      if (random() % 4 == 0)
+         return {0, 0};
+      const uint32_t from = now - random() % 100000;
+      return {from, from + 300 + static_cast<uint32_t>(random() % 200000)};
+   };
+   std::vector<std::vector<permission>> charts(1024);
+   for (auto &chart : charts)
+   {
+      for (size_t i = 0; i < permissions_count; i++)
+      {
+         permission perm{};
+         perm.right = random() % 3;
+         perm.interval = random_interval();
+         const auto specialties = perm.right == READ ? 1 + random() % 4 : 1;
+         for (size_t j = 0; j < specialties; j++)
+            perm.specialtyids.push_back(random() % 32);
+         chart.push_back(perm);
+      }
+   }
+   std::vector<read_request> requests(1024);
+   for (auto &request : requests)
+   {
+      const auto specialties = 1 + random() % 3;
+      for (size_t j = 0; j < specialties; j++)
+         request.specialtyids.push_back(static_cast<uint8_t>(j * 10 + random() % 10));
+      const uint32_t from = now - random() % 50000;
+      request.interval = {from, from + static_cast<uint32_t>(random() % 50000)};
+   }
+
+   /* Answers must be the same before timing them */
+   for (size_t i = 0; i < requests.size(); i++)
+   {
+      const auto &chart = charts[i % charts.size()];
+      if (legacy_read(chart, requests[i]) != engine_read(chart, requests[i]) ||
+          legacy_write(chart, requests[i].specialtyids[0], now) != engine_write(chart, requests[i].specialtyids[0], now))
+      {
+         std::fprintf(stderr, "engine disagrees with legacy check for request %zu\n", i);
+         return 1;
+      }
+   }
+
+   size_t sink = 0;
+   const auto legacy_read_ms = measure([&]() {
+      for (size_t i = 0; i < iterations; i++)
+         sink += legacy_read(charts[i % charts.size()], requests[i % requests.size()]).size();
+   });
+   const auto engine_read_ms = measure([&]() {
+      for (size_t i = 0; i < iterations; i++)
+         sink += engine_read(charts[i % charts.size()], requests[i % requests.size()]).size();
+   });
+   const auto legacy_write_ms = measure([&]() {
+      for (size_t i = 0; i < iterations; i++)
+         sink += legacy_write(charts[i % charts.size()], static_cast<uint8_t>(i % 32), now);
+   });
+   const auto engine_write_ms = measure([&]() {
+      for (size_t i = 0; i < iterations; i++)
+         sink += engine_write(charts[i % charts.size()], static_cast<uint8_t>(i % 32), now);
+   });
+
+   std::printf("permissions=%lu iterations=%lu\n", permissions_count, iterations);
+   std::printf("read   legacy=%.1fms engine=%.1fms speedup=%.2fx\n", legacy_read_ms, engine_read_ms, legacy_read_ms / engine_read_ms);
+   std::printf("write  legacy=%.1fms engine=%.1fms speedup=%.2fx\n", legacy_write_ms, engine_write_ms, legacy_write_ms / engine_write_ms);
+   return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+#include "chain.hpp"
+#include "medical.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action);
+
+/*
+   Heap allocations and time per action of the medical contract, run on the host chain of shardsim
+   Built twice: arenabench runs the contract as deployed, arenabench_heap one built with ACTION_ARENA_DISABLED, which
+   sends every arena allocation to the general-purpose allocator. Allocations are counted while apply runs, so they
+   include those of the emulated intrinsics, which both builds make alike; time is of the whole transaction
+*/
+namespace
+{
+   const eosio::name MEDICAL{"medical"};
+   const uint8_t SPECIALTIES = 8;
+   /* Doctors each patient grants to, one per specialty */
+   const uint32_t GRANTS = 4;
+   /* DER encoded RSA-2048 public key and ciphertext of RSA-2048 */
+   const size_t PUBLIC_KEY_SIZE = 294;
+   const size_t CIPHERTEXT_SIZE = 256;
+
+   thread_local bool t_counting = false;
+   thread_local uint64_t t_allocations = 0;
+   thread_local uint64_t t_bytes = 0;
+
+   void counted_apply(uint64_t receiver, uint64_t code, uint64_t action)
+   {
+      t_counting = true;
+      try
+      {
+         apply(receiver, code, action);
+      }
+      catch (...)
+      {
+         t_counting = false;
+         throw;
+      }
+      t_counting = false;
+   }
+
+   struct action_stats
+   {
+      uint64_t calls = 0;
+      uint64_t allocations = 0;
+      uint64_t bytes = 0;
+      double seconds = 0;
+   };
+
+   std::map<std::string, action_stats> stats;
+   unsigned failures = 0;
+
+   template <typename... Args>
+   void measure(eosio::name signer, eosio::name action, const Args &... args)
+   {
+      t_allocations = t_bytes = 0;
+      const auto started = std::chrono::steady_clock::now();
+      const auto receipt = shardsim::push(signer, MEDICAL, action, args...);
+      const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+      if (!receipt.applied)
+      {
+         failures++;
+         std::fprintf(stderr, "FAILED: %s: %s\n", action.to_string().c_str(), receipt.error.c_str());
+         return;
+      }
+      auto &entry = stats[action.to_string()];
+      entry.calls++;
+      entry.allocations += t_allocations;
+      entry.bytes += t_bytes;
+      entry.seconds += seconds;
+   }
+
+   /* Key of size bytes in the base64 text actions take */
+   std::string key_text(size_t size, uint8_t seed)
+   {
+      std::vector<uint8_t> key(size + 1);
+      key[0] = keys::BINARY_FORMAT;
+      for (size_t i = 1; i <= size; i++)
+         key[i] = static_cast<uint8_t>(seed + i * 31);
+      return keys::encode_text(key);
+   }
+
+   /* Valid account name of prefix followed by index in letters */
+   eosio::name account_at(const std::string &prefix, uint32_t index)
+   {
+      std::string name = prefix;
+      for (auto i = 0; i < 4; i++, index /= 26)
+         name += static_cast<char>('a' + index % 26);
+      return eosio::name{name};
+   }
+
+   void usage()
+   {
+      std::fprintf(stderr, "usage: arenabench [--patients <n>] [--rounds <n>]\n");
+   }
+} // namespace
+
+void *operator new(size_t size)
+{
+   if (t_counting)
+   {
+      t_allocations++;
+      t_bytes += size;
+   }
+   if (const auto block = std::malloc(size == 0 ? 1 : size))
+      return block;
+   throw std::bad_alloc{};
+}
+
+void operator delete(void *block) noexcept
+{
+   std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+   std::free(block);
+}
+
+int main(int argc, char **argv)
+{
+   uint32_t patients = 200, rounds = 5;
+   for (auto i = 1; i < argc; i++)
+   {
+      const std::string arg = argv[i];
+      if (arg == "--patients" && i + 1 < argc)
+         patients = static_cast<uint32_t>(std::stoul(argv[++i]));
+      else if (arg == "--rounds" && i + 1 < argc)
+         rounds = static_cast<uint32_t>(std::stoul(argv[++i]));
+      else
+      {
+         usage();
+         return 2;
+      }
+   }
+
+   shardsim::create_account(MEDICAL, counted_apply);
+   for (const auto setup : {"loadrights", "begloaddspcs", "fnshloadspcs"})
+      measure(MEDICAL, eosio::name{setup});
+   for (uint8_t specialty = 0; specialty < SPECIALTIES; specialty++)
+   {
+      const auto doctor = account_at("doc", specialty);
+      shardsim::create_account(doctor);
+      measure(MEDICAL, eosio::name{"upsertdoc"}, doctor, specialty, key_text(PUBLIC_KEY_SIZE, specialty));
+   }
+
+   /* Every patient grants reading and writing of one specialty to a few doctors, permission ids follow grant order */
+   for (uint32_t index = 0; index < patients; index++)
+   {
+      const auto patient = account_at("pat", index);
+      shardsim::create_account(patient);
+      measure(MEDICAL, eosio::name{"upsertpat"}, patient, key_text(PUBLIC_KEY_SIZE, static_cast<uint8_t>(index)));
+      for (uint32_t grant = 0; grant < GRANTS; grant++)
+      {
+         const uint8_t specialty = (index + grant) % SPECIALTIES;
+         measure(patient, eosio::name{"addperm"}, medical::perm_info{patient, account_at("doc", specialty)}, std::vector<uint8_t>{specialty},
+                 static_cast<uint8_t>(medical::right::READ_WRITE), medical::interval{0, 0}, key_text(CIPHERTEXT_SIZE, specialty));
+      }
+   }
+
+   /* Charts grow every round, so reads answer with more records each time */
+   for (uint32_t round = 0; round < rounds; round++)
+   {
+      shardsim::advance(60);
+      const auto now = shardsim::now();
+      for (uint32_t index = 0; index < patients; index++)
+      {
+         const auto patient = account_at("pat", index);
+         for (uint32_t grant = 0; grant < GRANTS; grant++)
+         {
+            const uint8_t specialty = (index + grant) % SPECIALTIES;
+            const medical::perm_info perm{patient, account_at("doc", specialty)};
+            measure(perm.doctor, eosio::name{"writerecord"}, perm, specialty,
+                    medical::record_info{std::to_string(round * patients + index), "visit"});
+            measure(perm.doctor, eosio::name{"readrecords"}, perm, std::vector<uint8_t>{specialty}, medical::interval{now - 3600, now},
+                    uint64_t{0});
+            measure(patient, eosio::name{"updtperm"}, perm, uint64_t{grant}, std::vector<uint8_t>{specialty},
+                    static_cast<uint8_t>(medical::right::READ_WRITE), medical::interval{0, 0});
+         }
+      }
+   }
+
+#ifdef ACTION_ARENA_DISABLED
+   std::printf("arena disabled\n");
+#else
+   std::printf("arena enabled, %zu bytes\n", action_arena::CAPACITY);
+#endif
+   std::printf("%-14s %8s %12s %12s %10s\n", "action", "calls", "allocs/call", "bytes/call", "us/call");
+   for (const auto &[action, entry] : stats)
+   {
+      std::printf("%-14s %8llu %12.1f %12.0f %10.2f\n", action.c_str(), static_cast<unsigned long long>(entry.calls),
+                  static_cast<double>(entry.allocations) / entry.calls, static_cast<double>(entry.bytes) / entry.calls,
+                  entry.seconds * 1e6 / entry.calls);
+   }
+   return failures == 0 ? 0 : 1;
+}
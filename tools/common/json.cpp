@@ -0,0 +1,194 @@
+#include "json.hpp"
+#include <cstdlib>
+
+namespace
+{
+   int hex_digit(const char c)
+   {
+      if (c >= '0' && c <= '9')
+         return c - '0';
+      if (c >= 'a' && c <= 'f')
+         return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F')
+         return c - 'A' + 10;
+      return -1;
+   }
+
+   class json_parser
+   {
+   public:
+      explicit json_parser(const std::string &json) : m_json{json}, m_pos{0}
+      {
+      }
+
+      bool parse(json_value &root, std::string &error)
+      {
+         if (!value(root) || (skip_whitespace(), m_pos != m_json.size()))
+         {
+            error = "malformed JSON at offset " + std::to_string(m_pos);
+            return false;
+         }
+         return true;
+      }
+
+   private:
+      void skip_whitespace()
+      {
+         while (m_pos < m_json.size() && (m_json[m_pos] == ' ' || m_json[m_pos] == '\n' || m_json[m_pos] == '\r' || m_json[m_pos] == '\t'))
+            m_pos++;
+      }
+
+      bool consume(const char expected)
+      {
+         skip_whitespace();
+         if (m_pos >= m_json.size() || m_json[m_pos] != expected)
+            return false;
+         m_pos++;
+         return true;
+      }
+
+      bool string(std::string &out)
+      {
+         if (!consume('"'))
+            return false;
+         out.clear();
+         while (m_pos < m_json.size() && m_json[m_pos] != '"')
+         {
+            auto c = m_json[m_pos++];
+            if (c != '\\')
+            {
+               out += c;
+               continue;
+            }
+            if (m_pos >= m_json.size())
+               return false;
+            switch (c = m_json[m_pos++])
+            {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+               if (m_pos + 4 > m_json.size())
+                  return false;
+               uint32_t code = 0;
+               for (auto i = 0; i < 4; i++)
+               {
+                  const auto digit = hex_digit(m_json[m_pos++]);
+                  if (digit < 0)
+                     return false;
+                  code = code << 4 | uint32_t(digit);
+               }
+               /* Only basic multilingual plane is emitted by cleos */
+               if (code < 0x80)
+                  out += char(code);
+               else if (code < 0x800)
+                  out += char(0xC0 | (code >> 6)), out += char(0x80 | (code & 0x3F));
+               else
+                  out += char(0xE0 | (code >> 12)), out += char(0x80 | ((code >> 6) & 0x3F)), out += char(0x80 | (code & 0x3F));
+               break;
+            }
+            default: out += c; break;
+            }
+         }
+         return m_pos++ < m_json.size();
+      }
+
+      bool value(json_value &out)
+      {
+         skip_whitespace();
+         if (m_pos >= m_json.size())
+            return false;
+
+         switch (m_json[m_pos])
+         {
+         case '{':
+            out.kind = json_value::OBJECT;
+            m_pos++;
+            if (consume('}'))
+               return true;
+            do
+            {
+               out.members.emplace_back();
+               if (!string(out.members.back().first) || !consume(':') || !value(out.members.back().second))
+                  return false;
+            } while (consume(','));
+            return consume('}');
+         case '[':
+            out.kind = json_value::ARRAY;
+            m_pos++;
+            if (consume(']'))
+               return true;
+            do
+            {
+               out.elements.emplace_back();
+               if (!value(out.elements.back()))
+                  return false;
+            } while (consume(','));
+            return consume(']');
+         case '"':
+            out.kind = json_value::STRING;
+            return string(out.text);
+         default:
+         {
+            const auto begin = m_pos;
+            while (m_pos < m_json.size() && m_json[m_pos] != ',' && m_json[m_pos] != '}' && m_json[m_pos] != ']' &&
+                   m_json[m_pos] != ' ' && m_json[m_pos] != '\n' && m_json[m_pos] != '\r' && m_json[m_pos] != '\t')
+               m_pos++;
+            out.text = m_json.substr(begin, m_pos - begin);
+            if (out.text == "null")
+               out.kind = json_value::NUL;
+            else if (out.text == "true" || out.text == "false")
+               out.kind = json_value::BOOLEAN;
+            else if (!out.text.empty() && (out.text[0] == '-' || (out.text[0] >= '0' && out.text[0] <= '9')))
+               out.kind = json_value::NUMBER;
+            else
+               return false;
+            return true;
+         }
+         }
+      }
+
+      const std::string &m_json;
+      size_t m_pos;
+   };
+} // namespace
+
+const json_value *json_value::find(const std::string &key) const noexcept
+{
+   for (const auto &member : members)
+      if (member.first == key)
+         return &member.second;
+   return nullptr;
+}
+
+uint64_t json_value::as_uint() const noexcept
+{
+   if (kind != NUMBER && kind != STRING)
+      return 0;
+   char *end = nullptr;
+   const auto number = std::strtoull(text.c_str(), &end, 10);
+   return end != text.c_str() && *end == '\0' ? number : 0;
+}
+
+bool json_value::as_bytes(std::string &bytes) const
+{
+   if (kind != STRING || text.size() % 2 != 0)
+      return false;
+   bytes.resize(text.size() / 2);
+   for (size_t i = 0; i < bytes.size(); i++)
+   {
+      const auto high = hex_digit(text[2 * i]), low = hex_digit(text[2 * i + 1]);
+      if (high < 0 || low < 0)
+         return false;
+      bytes[i] = static_cast<char>(high << 4 | low);
+   }
+   return true;
+}
+
+bool parse_json(const std::string &json, json_value &root, std::string &error)
+{
+   return json_parser{json}.parse(root, error);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Document tree of a parsed JSON, as produced by cleos table dumps */
+struct json_value
+{
+   enum kind_enum : uint8_t
+   {
+      NUL,
+      BOOLEAN,
+      NUMBER,
+      STRING,
+      ARRAY,
+      OBJECT
+   };
+
+   kind_enum kind = NUL;
+   /* Text of strings, numbers and booleans; numbers are kept as text so that uint64 values are not rounded */
+   std::string text;
+   std::vector<json_value> elements;
+   std::vector<std::pair<std::string, json_value>> members;
+
+   /* Returns member with given key, or nullptr when there is none or value is not an object */
+   const json_value *find(const std::string &key) const noexcept;
+
+   /* Number or numeric string as unsigned integer, 0 when value is not numeric */
+   uint64_t as_uint() const noexcept;
+
+   /* Hex string as bytes, the way cleos get table --binary prints packed rows; false when value is not hex */
+   bool as_bytes(std::string &bytes) const;
+};
+
+bool parse_json(const std::string &json, json_value &root, std::string &error);
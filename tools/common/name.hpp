@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/* Conversion between eosio account names and their uint64 encoding, same as eosio::name */
+namespace account_name
+{
+   inline uint64_t char_to_value(const char c) noexcept
+   {
+      if (c == '.')
+         return 0;
+      if (c >= '1' && c <= '5')
+         return uint64_t(c - '1') + 1;
+      if (c >= 'a' && c <= 'z')
+         return uint64_t(c - 'a') + 6;
+      return 0;
+   }
+
+   inline uint64_t from_string(const std::string &text) noexcept
+   {
+      uint64_t value = 0;
+      for (size_t i = 0; i < text.size() && i < 12; i++)
+         value |= (char_to_value(text[i]) & 0x1F) << (64 - 5 * (i + 1));
+      if (text.size() > 12)
+         value |= char_to_value(text[12]) & 0x0F;
+      return value;
+   }
+
+   inline std::string to_string(const uint64_t value)
+   {
+      static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string text(13, '.');
+      auto tmp = value;
+      for (auto i = 0; i <= 12; i++)
+      {
+         const auto c = charmap[tmp & (i == 0 ? 0x0F : 0x1F)];
+         text[12 - i] = c;
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      const auto last = text.find_last_not_of('.');
+      text.resize(last == std::string::npos ? 0 : last + 1);
+      return text;
+   }
+} // namespace account_name
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/* Reader of eosio packed data, as stored in contract tables */
+class packed_reader
+{
+public:
+   packed_reader(const std::string &data, size_t begin, size_t end) : m_data{data}, m_pos{begin}, m_end{end}
+   {
+   }
+
+   bool fixed(uint64_t &out, const size_t size)
+   {
+      if (m_end - m_pos < size)
+         return false;
+      out = 0;
+      for (size_t i = 0; i < size; i++)
+         out |= uint64_t(uint8_t(m_data[m_pos + i])) << (8 * i);
+      m_pos += size;
+      return true;
+   }
+
+   bool varuint(uint64_t &out)
+   {
+      out = 0;
+      for (auto shift = 0; shift < 35; shift += 7)
+      {
+         if (m_pos >= m_end)
+            return false;
+         const auto byte = uint8_t(m_data[m_pos++]);
+         out |= uint64_t(byte & 0x7F) << shift;
+         if ((byte & 0x80) == 0)
+            return true;
+      }
+      return false;
+   }
+
+   bool bytes(std::string &out)
+   {
+      uint64_t size;
+      if (!varuint(size) || m_end - m_pos < size)
+         return false;
+      out.assign(m_data, m_pos, size);
+      m_pos += size;
+      return true;
+   }
+
+   bool at_end() const
+   {
+      return m_pos == m_end;
+   }
+
+   /* Unread bytes, for rows decoded by other readers */
+   const char *data() const
+   {
+      return m_data.data() + m_pos;
+   }
+
+   size_t remaining() const
+   {
+      return m_end - m_pos;
+   }
+
+private:
+   const std::string &m_data;
+   size_t m_pos;
+   size_t m_end;
+};
+
+/*
+   Visits rows of a table dump, where every packed row is prefixed by its uint32 little endian size
+   Returns offset of the first malformed row, or dump size when all rows were visited
+*/
+template <typename Visitor>
+size_t for_each_dumped_row(const std::string &dump, Visitor visitor)
+{
+   size_t pos = 0;
+   while (pos < dump.size())
+   {
+      uint64_t size;
+      packed_reader prefix{dump, pos, dump.size()};
+      if (!prefix.fixed(size, 4) || dump.size() - pos - 4 < size)
+         return pos;
+      packed_reader row{dump, pos + 4, pos + 4 + size};
+      if (!visitor(row))
+         return pos;
+      pos += 4 + size;
+   }
+   return pos;
+}
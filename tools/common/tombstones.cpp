@@ -0,0 +1,73 @@
+#include "tombstones.hpp"
+#include "json.hpp"
+#include "name.hpp"
+#include "packed_reader.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+   bool load_scope(const std::string &path, std::unordered_set<uint64_t> &ids, std::string &error)
+   {
+      std::ifstream file{path, std::ios::binary};
+      if (!file)
+      {
+         error = "can't open " + path;
+         return false;
+      }
+      const std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+      json_value document;
+      if (!parse_json(json, document, error))
+      {
+         error = path + ": " + error;
+         return false;
+      }
+      const auto rows = document.find("rows");
+      if (rows == nullptr || rows->kind != json_value::ARRAY)
+      {
+         error = path + ": rows are missing";
+         return false;
+      }
+      for (size_t i = 0; i < rows->elements.size(); i++)
+      {
+         /* Layout of medical::tombstone: uint64 id */
+         std::string row;
+         uint64_t id;
+         const auto is_hex = rows->elements[i].as_bytes(row);
+         packed_reader reader{row, 0, row.size()};
+         if (!is_hex || !reader.fixed(id, 8) || !reader.at_end())
+         {
+            error = path + ": row " + std::to_string(i) + " is not a packed row of tombstones table";
+            return false;
+         }
+         ids.insert(id);
+      }
+      return true;
+   }
+} // namespace
+
+bool removed_records::load(const std::string &dir, std::string &error)
+{
+   /* Tombstones table is scoped by patient, cleos dumps one scope per file */
+   std::error_code code;
+   for (const auto &file : std::filesystem::directory_iterator{dir, code})
+   {
+      if (file.path().extension() != ".json")
+         continue;
+      if (!load_scope(file.path().string(), m_ids[account_name::from_string(file.path().stem().string())], error))
+         return false;
+   }
+   if (code)
+   {
+      error = "can't list " + dir + ": " + code.message();
+      return false;
+   }
+   return true;
+}
+
+bool removed_records::contains(const uint64_t patient, const uint8_t specialtyid, const uint32_t position) const
+{
+   const auto ids_iter = m_ids.find(patient);
+   return ids_iter != m_ids.end() && ids_iter->second.count(static_cast<uint64_t>(specialtyid) << 32 | position) != 0;
+}
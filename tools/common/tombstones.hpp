@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+   Records removed from patient charts but not yet compacted out of records table
+   Dumps of records table still hold them, so every reader of such dumps must skip them as the contract does
+*/
+class removed_records
+{
+public:
+   /* Loads tombstones tables from a directory of <patient>.json files, as printed by cleos get table --binary */
+   bool load(const std::string &dir, std::string &error);
+
+   /* Whether record at position within specialty records of patient was removed */
+   bool contains(uint64_t patient, uint8_t specialtyid, uint32_t position) const;
+
+private:
+   /* Tombstone ids by patient, specialty id in the upper half and position in the lower half as in medical::tombstone */
+   std::unordered_map<uint64_t, std::unordered_set<uint64_t>> m_ids;
+};
@@ -0,0 +1,243 @@
+#include "chart.hpp"
+#include "packed_reader.hpp"
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+   bool read_file(const std::string &path, std::string &content, std::string &error)
+   {
+      std::ifstream file{path, std::ios::binary};
+      if (!file)
+      {
+         error = "can't open " + path;
+         return false;
+      }
+      content.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+      return true;
+   }
+
+   /* Minimal JSON reader, walks the document and collects record objects without building a tree */
+   class json_reader
+   {
+   public:
+      json_reader(const std::string &json, std::vector<chart_record> &records) : m_json{json}, m_pos{0}, m_records{records}
+      {
+      }
+
+      bool read(std::string &error)
+      {
+         if (!value("", nullptr) || (skip_whitespace(), m_pos != m_json.size()))
+         {
+            error = "malformed JSON at offset " + std::to_string(m_pos);
+            return false;
+         }
+         return true;
+      }
+
+   private:
+      void skip_whitespace()
+      {
+         while (m_pos < m_json.size() && (m_json[m_pos] == ' ' || m_json[m_pos] == '\n' || m_json[m_pos] == '\r' || m_json[m_pos] == '\t'))
+            m_pos++;
+      }
+
+      bool consume(const char expected)
+      {
+         skip_whitespace();
+         if (m_pos >= m_json.size() || m_json[m_pos] != expected)
+            return false;
+         m_pos++;
+         return true;
+      }
+
+      bool string(std::string &out)
+      {
+         if (!consume('"'))
+            return false;
+         out.clear();
+         while (m_pos < m_json.size() && m_json[m_pos] != '"')
+         {
+            auto c = m_json[m_pos++];
+            if (c == '\\')
+            {
+               if (m_pos >= m_json.size())
+                  return false;
+               switch (c = m_json[m_pos++])
+               {
+               case 'b': out += '\b'; break;
+               case 'f': out += '\f'; break;
+               case 'n': out += '\n'; break;
+               case 'r': out += '\r'; break;
+               case 't': out += '\t'; break;
+               case 'u':
+               {
+                  if (m_pos + 4 > m_json.size())
+                     return false;
+                  const auto code = std::stoul(m_json.substr(m_pos, 4), nullptr, 16);
+                  m_pos += 4;
+                  /* Only basic multilingual plane is needed for hashes and specialty names */
+                  if (code < 0x80)
+                     out += char(code);
+                  else if (code < 0x800)
+                     out += char(0xC0 | (code >> 6)), out += char(0x80 | (code & 0x3F));
+                  else
+                     out += char(0xE0 | (code >> 12)), out += char(0x80 | ((code >> 6) & 0x3F)), out += char(0x80 | (code & 0x3F));
+                  break;
+               }
+               default: out += c; break;
+               }
+            }
+            else
+            {
+               out += c;
+            }
+         }
+         return m_pos++ < m_json.size();
+      }
+
+      /* Reads any value, scalars are returned through scalar when requested */
+      bool value(const std::string &context, std::string *scalar)
+      {
+         skip_whitespace();
+         if (m_pos >= m_json.size())
+            return false;
+
+         switch (m_json[m_pos])
+         {
+         case '{':
+            return object(context);
+         case '[':
+            return array(context);
+         case '"':
+         {
+            std::string text;
+            if (!string(text))
+               return false;
+            if (scalar != nullptr)
+               *scalar = std::move(text);
+            return true;
+         }
+         default:
+         {
+            const auto begin = m_pos;
+            while (m_pos < m_json.size() && m_json[m_pos] != ',' && m_json[m_pos] != '}' && m_json[m_pos] != ']' &&
+                   m_json[m_pos] != ' ' && m_json[m_pos] != '\n' && m_json[m_pos] != '\r' && m_json[m_pos] != '\t')
+               m_pos++;
+            if (begin == m_pos)
+               return false;
+            if (scalar != nullptr)
+               *scalar = m_json.substr(begin, m_pos - begin);
+            return true;
+         }
+         }
+      }
+
+      bool array(const std::string &context)
+      {
+         consume('[');
+         if (consume(']'))
+            return true;
+         do
+         {
+            if (!value(context, nullptr))
+               return false;
+         } while (consume(','));
+         return consume(']');
+      }
+
+      bool object(const std::string &context)
+      {
+         consume('{');
+         std::map<std::string, std::string> scalars;
+         if (!consume('}'))
+         {
+            do
+            {
+               std::string key;
+               if (!string(key) || !consume(':'))
+                  return false;
+               /* Records of table rows are nested as {"key": specialty, "value": [records]} */
+               const auto key_iter = scalars.find("key");
+               const auto child_context = key == "value" && key_iter != scalars.end() ? key_iter->second : key;
+               std::string scalar;
+               if (!value(child_context, &scalar))
+                  return false;
+               scalars[key] = std::move(scalar);
+            } while (consume(','));
+            if (!consume('}'))
+               return false;
+         }
+
+         const auto hash_iter = scalars.find("hash");
+         const auto timestamp_iter = scalars.find("timestamp");
+         if (hash_iter != scalars.end() && timestamp_iter != scalars.end())
+            m_records.push_back({context, static_cast<uint32_t>(std::stoul(timestamp_iter->second)), hash_iter->second});
+         return true;
+      }
+
+      const std::string &m_json;
+      size_t m_pos;
+      std::vector<chart_record> &m_records;
+   };
+
+   /* Layout of medical::record: patient name, then map of specialty id to vector of recordetails */
+   bool read_record_row(packed_reader &reader, const removed_records &removed, std::vector<chart_record> &records)
+   {
+      uint64_t patient, specialties;
+      if (!reader.fixed(patient, 8) || !reader.varuint(specialties))
+         return false;
+      for (uint64_t i = 0; i < specialties; i++)
+      {
+         uint64_t specialtyid, count;
+         if (!reader.fixed(specialtyid, 1) || !reader.varuint(count))
+            return false;
+         for (uint64_t j = 0; j < count; j++)
+         {
+            uint64_t timestamp, doctor;
+            std::string hash, description;
+            if (!reader.fixed(timestamp, 4) || !reader.bytes(hash) || !reader.fixed(doctor, 8) || !reader.bytes(description))
+               return false;
+            if (!removed.contains(patient, static_cast<uint8_t>(specialtyid), static_cast<uint32_t>(j)))
+               records.push_back({std::to_string(specialtyid), static_cast<uint32_t>(timestamp), std::move(hash)});
+         }
+      }
+      return reader.at_end();
+   }
+} // namespace
+
+bool load_chart_json(const std::string &path, std::vector<chart_record> &records, std::string &error)
+{
+   std::string json;
+   if (!read_file(path, json, error))
+      return false;
+   try
+   {
+      if (json_reader{json, records}.read(error))
+         return true;
+   }
+   catch (const std::exception &)
+   {
+      /* Thrown by numbers conversion of malformed timestamps or escapes */
+      error = "malformed number";
+   }
+   error = path + ": " + error;
+   return false;
+}
+
+bool load_chart_dump(const std::string &path, const removed_records &removed, std::vector<chart_record> &records, std::string &error)
+{
+   std::string dump;
+   if (!read_file(path, dump, error))
+      return false;
+
+   const auto end = for_each_dumped_row(dump, [&removed, &records](packed_reader &row) { return read_record_row(row, removed, records); });
+   if (end != dump.size())
+   {
+      error = path + ": malformed row at offset " + std::to_string(end);
+      return false;
+   }
+   return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "tombstones.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Record of a patient chart, as exported by recordstab or dumped from records table */
+struct chart_record
+{
+   /* Specialty name or id the record belongs to */
+   std::string specialty;
+   uint32_t timestamp;
+   std::string hash;
+};
+
+/*
+   Loads records from recordstab JSON output or from records table JSON rows
+   Every object having both "hash" and "timestamp" members is taken as a record
+*/
+bool load_chart_json(const std::string &path, std::vector<chart_record> &records, std::string &error);
+
+/*
+   Loads records from binary dump of records table, where every packed row is prefixed by its uint32 little endian size
+   Removed records which are still in the dump are skipped
+*/
+bool load_chart_dump(const std::string &path, const removed_records &removed, std::vector<chart_record> &records, std::string &error);
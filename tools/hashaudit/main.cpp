@@ -0,0 +1,279 @@
+#include "chart.hpp"
+#include "sha256.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+   /* Size of read buffer used when file can't be memory mapped */
+   constexpr size_t READ_BUFFER_SIZE = 4 * 1024 * 1024;
+
+   struct options
+   {
+      std::string chart;
+      bool is_dump = false;
+      std::string tombstones;
+      bool report_missing = false;
+      bool verbose = false;
+      unsigned threads = 0;
+      std::vector<std::string> files;
+   };
+
+   struct file_result
+   {
+      std::string digest;
+      uint64_t size = 0;
+      std::string error;
+   };
+
+   void usage()
+   {
+      std::fprintf(stderr,
+                   "usage: hashaudit (--chart <recordstab.json> | --dump <records.bin> --tombstones <dir of <patient>.json>)\n"
+                   "                 [options] <file>...\n"
+                   "  --list <path>     read file paths from path, one per line\n"
+                   "  --threads <n>     number of hashing threads, all cores by default\n"
+                   "  --missing         report chart records which no file matched\n"
+                   "  --verbose         report matching files too\n");
+   }
+
+   bool parse_options(int argc, char **argv, options &opts)
+   {
+      for (auto i = 1; i < argc; i++)
+      {
+         const std::string arg = argv[i];
+         const auto has_value = i + 1 < argc;
+         if ((arg == "--chart" || arg == "--dump") && has_value)
+         {
+            opts.chart = argv[++i];
+            opts.is_dump = arg == "--dump";
+         }
+         else if (arg == "--tombstones" && has_value)
+            opts.tombstones = argv[++i];
+         else if (arg == "--list" && has_value)
+         {
+            std::ifstream list{argv[++i]};
+            if (!list)
+            {
+               std::fprintf(stderr, "can't open %s\n", argv[i]);
+               return false;
+            }
+            for (std::string path; std::getline(list, path);)
+               if (!path.empty())
+                  opts.files.push_back(path);
+         }
+         else if (arg == "--threads" && has_value)
+            opts.threads = std::stoul(argv[++i]);
+         else if (arg == "--missing")
+            opts.report_missing = true;
+         else if (arg == "--verbose")
+            opts.verbose = true;
+         else if (!arg.empty() && arg[0] != '-')
+            opts.files.push_back(arg);
+         else
+            return false;
+      }
+      /* Records dump still holds removed records until compaction, it can't be audited without their tombstones */
+      return !opts.chart.empty() && !opts.files.empty() && opts.is_dump == !opts.tombstones.empty();
+   }
+
+   std::string to_hex(const sha256::digest &digest)
+   {
+      static const char digits[] = "0123456789abcdef";
+      std::string hex(digest.size() * 2, '0');
+      for (size_t i = 0; i < digest.size(); i++)
+      {
+         hex[2 * i] = digits[digest[i] >> 4];
+         hex[2 * i + 1] = digits[digest[i] & 0xF];
+      }
+      return hex;
+   }
+
+   std::string to_base64(const sha256::digest &digest)
+   {
+      static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      std::string encoded;
+      for (size_t i = 0; i < digest.size(); i += 3)
+      {
+         const auto remaining = digest.size() - i;
+         const uint32_t triple = digest[i] << 16 | (remaining > 1 ? digest[i + 1] << 8 : 0) | (remaining > 2 ? digest[i + 2] : 0);
+         encoded += alphabet[(triple >> 18) & 0x3F];
+         encoded += alphabet[(triple >> 12) & 0x3F];
+         encoded += remaining > 1 ? alphabet[(triple >> 6) & 0x3F] : '=';
+         encoded += remaining > 2 ? alphabet[triple & 0x3F] : '=';
+      }
+      return encoded;
+   }
+
+   /*
+      Key of a chart hash in the expected map: hex digests in lowercase, as to_hex prints them; base64 digests are case
+      sensitive and kept as they are
+   */
+   std::string digest_key(std::string hash)
+   {
+      if (hash.size() != 2 * std::tuple_size<sha256::digest>::value ||
+          !std::all_of(hash.begin(), hash.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; }))
+         return hash;
+      for (auto &c : hash)
+         c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      return hash;
+   }
+
+   /* Streams file through SHA-256, memory mapped when possible, with large reads otherwise */
+   file_result hash_file(const std::string &path)
+   {
+      file_result result;
+      const auto fd = ::open(path.c_str(), O_RDONLY);
+      struct stat info;
+      if (fd < 0 || ::fstat(fd, &info) != 0)
+      {
+         result.error = std::strerror(errno);
+         if (fd >= 0)
+            ::close(fd);
+         return result;
+      }
+
+      sha256 hasher;
+      auto hashed = false;
+      if (S_ISREG(info.st_mode) && info.st_size > 0)
+      {
+         const auto size = static_cast<size_t>(info.st_size);
+         const auto mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (mapping != MAP_FAILED)
+         {
+            /* Advice values are not flags, each one is given on its own */
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            ::madvise(mapping, size, MADV_WILLNEED);
+            hasher.update(static_cast<const uint8_t *>(mapping), size);
+            ::munmap(mapping, size);
+            result.size = size;
+            hashed = true;
+         }
+      }
+      if (!hashed)
+      {
+         std::vector<uint8_t> buffer(READ_BUFFER_SIZE);
+         ssize_t count;
+         while ((count = ::read(fd, buffer.data(), buffer.size())) > 0)
+         {
+            hasher.update(buffer.data(), static_cast<size_t>(count));
+            result.size += static_cast<uint64_t>(count);
+         }
+         if (count < 0)
+            result.error = std::strerror(errno);
+      }
+      ::close(fd);
+
+      if (result.error.empty())
+         result.digest = to_hex(hasher.finish());
+      return result;
+   }
+} // namespace
+
+int main(int argc, char **argv)
+{
+   options opts;
+   if (!parse_options(argc, argv, opts))
+   {
+      usage();
+      return 2;
+   }
+
+   /* Load expected hashes from the chart */
+   std::vector<chart_record> records;
+   removed_records removed;
+   std::string error;
+   if (opts.is_dump ? !removed.load(opts.tombstones, error) || !load_chart_dump(opts.chart, removed, records, error)
+                    : !load_chart_json(opts.chart, records, error))
+   {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 2;
+   }
+   std::unordered_map<std::string, std::vector<size_t>> expected;
+   for (size_t i = 0; i < records.size(); i++)
+      expected[digest_key(records[i].hash)].push_back(i);
+
+   /* Files are handed out to threads one by one, so large and small files balance across cores */
+   const auto threads = opts.threads != 0 ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+   std::vector<file_result> results(opts.files.size());
+   std::atomic<size_t> next{0};
+   const auto started = std::chrono::steady_clock::now();
+   std::vector<std::thread> workers;
+   for (unsigned i = 0; i < threads; i++)
+   {
+      workers.emplace_back([&]() {
+         for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < opts.files.size();)
+            results[index] = hash_file(opts.files[index]);
+      });
+   }
+   for (auto &worker : workers)
+      worker.join();
+   const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+   /* Report files whose digest is not part of the chart, chart hashes are either hex (any case) or base64 encoded */
+   uint64_t total_bytes = 0;
+   size_t mismatches = 0, failures = 0;
+   std::vector<bool> matched(records.size(), false);
+   for (size_t i = 0; i < results.size(); i++)
+   {
+      const auto &result = results[i];
+      if (!result.error.empty())
+      {
+         std::printf("ERROR    %s: %s\n", opts.files[i].c_str(), result.error.c_str());
+         failures++;
+         continue;
+      }
+      total_bytes += result.size;
+
+      auto expected_iter = expected.find(result.digest);
+      if (expected_iter == expected.end())
+      {
+         sha256::digest digest;
+         for (size_t j = 0; j < digest.size(); j++)
+            digest[j] = uint8_t(std::stoul(result.digest.substr(2 * j, 2), nullptr, 16));
+         expected_iter = expected.find(to_base64(digest));
+      }
+      if (expected_iter == expected.end())
+      {
+         std::printf("MISMATCH %s %s\n", opts.files[i].c_str(), result.digest.c_str());
+         mismatches++;
+         continue;
+      }
+      for (const auto record_index : expected_iter->second)
+         matched[record_index] = true;
+      if (opts.verbose)
+      {
+         const auto &record = records[expected_iter->second.front()];
+         std::printf("OK       %s %s %s@%u\n", opts.files[i].c_str(), result.digest.c_str(), record.specialty.c_str(), record.timestamp);
+      }
+   }
+
+   size_t missing = 0;
+   for (size_t i = 0; i < records.size(); i++)
+   {
+      if (matched[i])
+         continue;
+      missing++;
+      if (opts.report_missing)
+         std::printf("MISSING  %s@%u %s\n", records[i].specialty.c_str(), records[i].timestamp, records[i].hash.c_str());
+   }
+
+   std::printf("files=%zu records=%zu mismatches=%zu errors=%zu unmatched_records=%zu bytes=%llu seconds=%.3f throughput=%.1fMiB/s threads=%u kernel=%s\n",
+               opts.files.size(), records.size(), mismatches, failures, missing, static_cast<unsigned long long>(total_bytes), elapsed,
+               elapsed > 0 ? total_bytes / elapsed / (1024 * 1024) : 0.0, threads, sha256::kernel_name());
+   return mismatches != 0 || failures != 0 ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+#include "sha256.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86_KERNEL 1
+#endif
+
+namespace
+{
+   alignas(16) const uint32_t K[64] = {
+       0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+       0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+       0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+       0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+       0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+       0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+       0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+       0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+   using compress_kernel = void (*)(uint32_t state[8], const uint8_t *blocks, size_t count);
+
+   inline uint32_t rotr(const uint32_t value, const int bits) noexcept
+   {
+      return (value >> bits) | (value << (32 - bits));
+   }
+
+   void compress_portable(uint32_t state[8], const uint8_t *blocks, size_t count)
+   {
+      uint32_t w[64];
+      for (; count != 0; count--, blocks += 64)
+      {
+         for (auto i = 0; i < 16; i++)
+            w[i] = uint32_t(blocks[4 * i]) << 24 | uint32_t(blocks[4 * i + 1]) << 16 | uint32_t(blocks[4 * i + 2]) << 8 | blocks[4 * i + 3];
+         for (auto i = 16; i < 64; i++)
+         {
+            const auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+         }
+
+         auto a = state[0], b = state[1], c = state[2], d = state[3];
+         auto e = state[4], f = state[5], g = state[6], h = state[7];
+         for (auto i = 0; i < 64; i++)
+         {
+            const auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            const auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+         }
+         state[0] += a, state[1] += b, state[2] += c, state[3] += d;
+         state[4] += e, state[5] += f, state[6] += g, state[7] += h;
+      }
+   }
+
+#ifdef SHA256_X86_KERNEL
+   /* Intel SHA extensions, 4 rounds per pair of sha256rnds2 */
+   __attribute__((target("sha,sse4.1"))) void compress_shani(uint32_t state[8], const uint8_t *blocks, size_t count)
+   {
+      const auto byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+      /* Reorder state into ABEF and CDGH lanes */
+      auto cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0])), 0xB1);
+      auto efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4])), 0x1B);
+      auto abef = _mm_alignr_epi8(cdab, efgh, 8);
+      auto cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+      __m128i w[16];
+      for (; count != 0; count--, blocks += 64)
+      {
+         const auto abef_saved = abef;
+         const auto cdgh_saved = cdgh;
+
+         for (auto i = 0; i < 4; i++)
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * i)), byteswap);
+         for (auto i = 4; i < 16; i++)
+            w[i] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i - 4], w[i - 3]), _mm_alignr_epi8(w[i - 1], w[i - 2], 4)), w[i - 1]);
+
+         for (auto i = 0; i < 16; i++)
+         {
+            auto message = _mm_add_epi32(w[i], _mm_load_si128(reinterpret_cast<const __m128i *>(&K[4 * i])));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            message = _mm_shuffle_epi32(message, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+         }
+
+         abef = _mm_add_epi32(abef, abef_saved);
+         cdgh = _mm_add_epi32(cdgh, cdgh_saved);
+      }
+
+      /* Restore state order */
+      const auto feba = _mm_shuffle_epi32(abef, 0x1B);
+      const auto dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), _mm_blend_epi16(feba, dchg, 0xF0));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+   }
+
+   bool has_sha_extensions() noexcept
+   {
+      unsigned int eax, ebx, ecx, edx;
+      if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+         return false;
+      if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+         return false;
+      return (ebx & (1u << 29)) != 0;
+   }
+#endif
+
+   struct kernel
+   {
+      compress_kernel compress;
+      const char *name;
+   };
+
+   const kernel &selected_kernel() noexcept
+   {
+      static const kernel selected = []() -> kernel {
+#ifdef SHA256_X86_KERNEL
+         if (has_sha_extensions())
+            return {compress_shani, "x86 sha extensions"};
+#endif
+         return {compress_portable, "portable"};
+      }();
+      return selected;
+   }
+} // namespace
+
+sha256::sha256() noexcept : m_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+                            m_buffer{},
+                            m_buffered{0},
+                            m_length{0}
+{
+}
+
+void sha256::update(const uint8_t *data, size_t size) noexcept
+{
+   const auto compress = selected_kernel().compress;
+   m_length += size;
+
+   /* Complete partially filled block first */
+   if (m_buffered != 0)
+   {
+      const auto needed = std::min(size, sizeof(m_buffer) - m_buffered);
+      std::memcpy(m_buffer + m_buffered, data, needed);
+      m_buffered += needed;
+      data += needed;
+      size -= needed;
+      if (m_buffered != sizeof(m_buffer))
+         return;
+      compress(m_state, m_buffer, 1);
+      m_buffered = 0;
+   }
+
+   /* Whole blocks are compressed straight from input */
+   const auto blocks = size / 64;
+   if (blocks != 0)
+   {
+      compress(m_state, data, blocks);
+      data += blocks * 64;
+      size -= blocks * 64;
+   }
+
+   std::memcpy(m_buffer, data, size);
+   m_buffered = size;
+}
+
+sha256::digest sha256::finish() noexcept
+{
+   const auto bit_length = m_length * 8;
+
+   /* Padding: 0x80, zeros and big endian bit length at the end of the last block */
+   uint8_t padding[72] = {0x80};
+   const auto padding_size = (m_buffered < 56 ? 56 : 120) - m_buffered;
+   for (auto i = 0; i < 8; i++)
+      padding[padding_size + i] = uint8_t(bit_length >> (56 - 8 * i));
+   update(padding, padding_size + 8);
+
+   digest result;
+   for (auto i = 0; i < 8; i++)
+   {
+      result[4 * i] = uint8_t(m_state[i] >> 24);
+      result[4 * i + 1] = uint8_t(m_state[i] >> 16);
+      result[4 * i + 2] = uint8_t(m_state[i] >> 8);
+      result[4 * i + 3] = uint8_t(m_state[i]);
+   }
+   return result;
+}
+
+const char *sha256::kernel_name() noexcept
+{
+   return selected_kernel().name;
+}
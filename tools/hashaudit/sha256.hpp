@@ -0,0 +1,25 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/* Streaming SHA-256, compression kernel is picked once according to CPU features */
+class sha256
+{
+public:
+   using digest = std::array<uint8_t, 32>;
+
+   sha256() noexcept;
+
+   void update(const uint8_t *data, size_t size) noexcept;
+   digest finish() noexcept;
+
+   /* Name of the compression kernel used on this CPU */
+   static const char *kernel_name() noexcept;
+
+private:
+   uint32_t m_state[8];
+   uint8_t m_buffer[64];
+   size_t m_buffered;
+   uint64_t m_length;
+};
@@ -0,0 +1,287 @@
+#include "engine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <unordered_map>
+
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action);
+
+namespace replay
+{
+   work_stealing_pool::work_stealing_pool(unsigned threads)
+   {
+      threads = std::max(threads, 1u);
+      for (unsigned worker = 0; worker < threads; worker++)
+         m_queues.push_back(std::make_unique<worker_queue>());
+      for (unsigned worker = 0; worker < threads; worker++)
+         m_threads.emplace_back([this, worker]() { work(worker); });
+   }
+
+   work_stealing_pool::~work_stealing_pool()
+   {
+      {
+         std::lock_guard<std::mutex> lock{m_mutex};
+         m_stopping = true;
+      }
+      m_wake.notify_all();
+      for (auto &thread : m_threads)
+         thread.join();
+   }
+
+   void work_stealing_pool::run(size_t count, const std::function<void(size_t)> &task)
+   {
+      if (count == 0)
+         return;
+
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_remaining = count;
+      /* Tasks are dealt round robin, in the order given, so that the first ones start first */
+      for (size_t index = 0; index < count; index++)
+      {
+         auto &queue = *m_queues[index % m_queues.size()];
+         std::lock_guard<std::mutex> queue_lock{queue.mutex};
+         queue.tasks.push_front({&task, index});
+      }
+      m_generation++;
+      m_wake.notify_all();
+      m_done.wait(lock, [this]() { return m_remaining == 0; });
+   }
+
+   bool work_stealing_pool::take(unsigned worker, queued_task &task)
+   {
+      for (unsigned offset = 0; offset < m_queues.size(); offset++)
+      {
+         auto &queue = *m_queues[(worker + offset) % m_queues.size()];
+         std::lock_guard<std::mutex> queue_lock{queue.mutex};
+         if (queue.tasks.empty())
+            continue;
+         if (offset == 0)
+         {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+         }
+         else
+         {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+         }
+         return true;
+      }
+      return false;
+   }
+
+   void work_stealing_pool::work(unsigned worker)
+   {
+      uint64_t seen_generation = 0;
+      while (true)
+      {
+         {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wake.wait(lock, [&]() { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping)
+               return;
+            seen_generation = m_generation;
+         }
+
+         for (queued_task task; take(worker, task);)
+         {
+            (*task.task)(task.index);
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (--m_remaining == 0)
+               m_done.notify_one();
+         }
+      }
+   }
+
+   void deploy(shardsim::chain &chain, eosio::name contract, const action_log &log)
+   {
+      shardsim::current_chain current{chain};
+      shardsim::create_account(contract, apply);
+      for (const auto account : log.accounts)
+         shardsim::create_account(account);
+   }
+
+   namespace
+   {
+      /*
+         Deferred transactions sent at a log position are numbered from the position, those sent by deferred transactions
+         which became due before the action ahead of those sent by the action, so that any part of the log sends them
+         with the sequences a whole serial run gives them
+      */
+      uint64_t due_sequence(size_t position)
+      {
+         return static_cast<uint64_t>(position) << 16;
+      }
+
+      uint64_t action_sequence(size_t position)
+      {
+         return static_cast<uint64_t>(position) << 16 | 1 << 15;
+      }
+
+      /* Runs deferred transactions due by the time of the action, then the action, on the current chain */
+      bool run_step(const action_log &log, size_t position)
+      {
+         const auto &logged = log.actions[position];
+         shardsim::set_deferred_sequence(due_sequence(position));
+         shardsim::advance(logged.time > shardsim::now() ? logged.time - shardsim::now() : 0);
+         shardsim::set_deferred_sequence(action_sequence(position));
+         return shardsim::push({logged.action}).applied;
+      }
+   } // namespace
+
+   stats replay_serial(shardsim::chain &chain, const action_log &log)
+   {
+      shardsim::current_chain current{chain};
+      stats result;
+      for (size_t position = 0; position < log.actions.size(); position++)
+         (run_step(log, position) ? result.applied : result.rejected)++;
+      return result;
+   }
+
+   namespace
+   {
+      struct partition
+      {
+         /* Positions of the partition actions in the log, ascending */
+         std::vector<size_t> actions;
+         std::unique_ptr<shardsim::chain> fork;
+         /* Position after the last action run on the fork */
+         size_t ran_until = 0;
+         stats counts;
+      };
+
+      /* First position in [begin, end) whose action is not older than time, end when there is none */
+      size_t first_at(const action_log &log, size_t begin, size_t end, uint32_t time)
+      {
+         return std::partition_point(log.actions.begin() + begin, log.actions.begin() + end,
+                                     [time](const logged_action &logged) { return logged.time < time; }) -
+                log.actions.begin();
+      }
+
+      void lower(std::atomic<size_t> &cut, size_t position)
+      {
+         for (auto current = cut.load(); position < current && !cut.compare_exchange_weak(current, position);)
+            ;
+      }
+
+      /*
+         Runs actions of the partition before the cut on a fresh fork of chain
+         Actions see the clock of their log entry but don't run deferred transactions: once a deferred transaction is
+         pending, the epoch is cut at the first later action due to run after it
+      */
+      void run_partition(const shardsim::chain &chain, const action_log &log, size_t end, std::atomic<size_t> &cut, partition &part)
+      {
+         part.fork = chain.fork();
+         part.ran_until = 0;
+         part.counts = {};
+         shardsim::current_chain current{*part.fork};
+         for (const auto position : part.actions)
+         {
+            if (position >= cut.load())
+               break;
+            const auto &logged = log.actions[position];
+            shardsim::set_clock(logged.time);
+            shardsim::set_deferred_sequence(action_sequence(position));
+            (shardsim::push({logged.action}).applied ? part.counts.applied : part.counts.rejected)++;
+            part.ran_until = position + 1;
+            if (const auto due = shardsim::next_due(); due != UINT32_MAX)
+               lower(cut, first_at(log, position + 1, end, due));
+         }
+      }
+   } // namespace
+
+   stats replay_parallel(shardsim::chain &chain, const action_log &log, work_stealing_pool &pool, size_t &epochs, size_t &reruns)
+   {
+      stats result;
+      epochs = reruns = 0;
+      std::vector<partition> partitions;
+      std::unordered_map<uint64_t, size_t> partition_of;
+
+      for (size_t begin = 0; begin < log.actions.size();)
+      {
+         /* Epoch runs until the next action which doesn't name a patient, or is due to run after a deferred transaction */
+         uint32_t due;
+         {
+            shardsim::current_chain current{chain};
+            due = shardsim::next_due();
+         }
+         auto end = begin;
+         while (end < log.actions.size() && log.actions[end].patient != 0 && log.actions[end].time < due)
+            end++;
+
+         partitions.clear();
+         partition_of.clear();
+         for (auto position = begin; position < end; position++)
+         {
+            const auto [partition_iter, inserted] = partition_of.emplace(log.actions[position].patient, partitions.size());
+            if (inserted)
+               partitions.emplace_back();
+            partitions[partition_iter->second].actions.push_back(position);
+         }
+         /* Largest partitions are dealt first, small ones fill the gaps by being stolen */
+         std::sort(partitions.begin(), partitions.end(), [](const auto &first, const auto &second) {
+            return first.actions.size() > second.actions.size();
+         });
+
+         /* Partitions without a fork are run, until every fork ran before the cut and no two conflict */
+         std::atomic<size_t> cut{end};
+         for (auto first_pass = true;; first_pass = false)
+         {
+            std::vector<size_t> pending;
+            for (size_t index = 0; index < partitions.size(); index++)
+               if (partitions[index].fork == nullptr)
+                  pending.push_back(index);
+            if (pending.empty())
+               break;
+            if (!first_pass)
+               reruns += pending.size();
+            const std::function<void(size_t)> task = [&](size_t index) { run_partition(chain, log, end, cut, partitions[pending[index]]); };
+            pool.run(pending.size(), task);
+
+            /* Partitions which ran past the final cut saw a state without the deferred transactions due before it */
+            std::vector<const shardsim::chain *> forks;
+            for (const auto &part : partitions)
+               forks.push_back(part.fork.get());
+            std::vector<partition> combined;
+            for (const auto &group : shardsim::conflicting_forks(forks))
+            {
+               if (group.size() == 1)
+               {
+                  combined.push_back(std::move(partitions[group.front()]));
+                  if (combined.back().ran_until > cut.load())
+                     combined.back().fork.reset();
+                  continue;
+               }
+               /* Conflicting partitions become one, which runs their actions in log order */
+               partition joined;
+               for (const auto index : group)
+                  joined.actions.insert(joined.actions.end(), partitions[index].actions.begin(), partitions[index].actions.end());
+               std::sort(joined.actions.begin(), joined.actions.end());
+               combined.push_back(std::move(joined));
+            }
+            partitions = std::move(combined);
+         }
+
+         for (const auto &part : partitions)
+         {
+            chain.merge(*part.fork);
+            result.applied += part.counts.applied;
+            result.rejected += part.counts.rejected;
+         }
+         partitions.clear();
+         epochs++;
+
+         if (const auto barrier = cut.load(); barrier < log.actions.size())
+         {
+            shardsim::current_chain current{chain};
+            (run_step(log, barrier) ? result.applied : result.rejected)++;
+            begin = barrier + 1;
+         }
+         else
+         {
+            begin = barrier;
+         }
+      }
+      return result;
+   }
+} // namespace replay
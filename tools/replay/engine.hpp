@@ -0,0 +1,81 @@
+#pragma once
+#include "log.hpp"
+#include "chain.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace replay
+{
+   /*
+      Fixed set of threads, each with its own deque of tasks
+      Owner takes tasks from the back of its deque, idle threads steal from the front of the others, so that a few
+      large partitions don't leave the rest of threads waiting
+   */
+   class work_stealing_pool
+   {
+   public:
+      explicit work_stealing_pool(unsigned threads);
+      work_stealing_pool(const work_stealing_pool &) = delete;
+      work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+      ~work_stealing_pool();
+
+      unsigned size() const noexcept { return static_cast<unsigned>(m_threads.size()); }
+
+      /* Runs task for every index in [0, count), returns once all of them completed */
+      void run(size_t count, const std::function<void(size_t)> &task);
+
+   private:
+      struct queued_task
+      {
+         const std::function<void(size_t)> *task;
+         size_t index;
+      };
+
+      struct worker_queue
+      {
+         std::mutex mutex;
+         std::deque<queued_task> tasks;
+      };
+
+      void work(unsigned worker);
+      bool take(unsigned worker, queued_task &task);
+
+      std::vector<std::unique_ptr<worker_queue>> m_queues;
+      std::vector<std::thread> m_threads;
+      std::mutex m_mutex;
+      std::condition_variable m_wake;
+      std::condition_variable m_done;
+      uint64_t m_generation = 0;
+      size_t m_remaining = 0;
+      bool m_stopping = false;
+   };
+
+   /* Applied and rejected log actions; deferred transactions the contract sends are not counted */
+   struct stats
+   {
+      uint64_t applied = 0;
+      uint64_t rejected = 0;
+   };
+
+   /* Chain with the contract deployed as contract, through its apply entry point, and every account of the log created */
+   void deploy(shardsim::chain &chain, eosio::name contract, const action_log &log);
+
+   /*
+      Reference replay, one action after another on the chain, after deferred transactions which became due by its time
+   */
+   stats replay_serial(shardsim::chain &chain, const action_log &log);
+
+   /*
+      Replay partitioned by patient
+      Log is cut into epochs at actions which don't name a patient and at actions after which a deferred transaction
+      becomes due; both run serially as barriers. Within an epoch the actions of every patient run in log order on a fork
+      of the chain on the pool; forks which read or wrote what another fork wrote are run again as one partition, until
+      no two conflict, then all are merged. Gives the same chain as replay_serial
+   */
+   stats replay_parallel(shardsim::chain &chain, const action_log &log, work_stealing_pool &pool, size_t &epochs, size_t &reruns);
+} // namespace replay
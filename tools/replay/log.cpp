@@ -0,0 +1,266 @@
+#include "log.hpp"
+#include "json.hpp"
+#include "medical.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+
+namespace
+{
+   const json_value &member_of(const json_value &object, const std::string &key)
+   {
+      static const json_value null;
+      const auto member = object.find(key);
+      return member != nullptr ? *member : null;
+   }
+
+   /* Accounts named by action data as patients, doctors or institutions, at any depth */
+   void collect_accounts(const json_value &value, std::set<uint64_t> &accounts)
+   {
+      for (const auto &[key, member] : value.members)
+      {
+         if ((key == "patient" || key == "doctor" || key == "institution") && member.kind == json_value::STRING)
+            accounts.insert(eosio::name{member.text}.value);
+         collect_accounts(member, accounts);
+      }
+      for (const auto &element : value.elements)
+         collect_accounts(element, accounts);
+   }
+
+   /* Patient of the actions working on a single patient, which name it directly or in their perm_info */
+   uint64_t patient_of(const json_value &data)
+   {
+      if (const auto &patient = member_of(data, "patient"); patient.kind == json_value::STRING)
+         return eosio::name{patient.text}.value;
+      if (const auto &patient = member_of(member_of(data, "perm"), "patient"); patient.kind == json_value::STRING)
+         return eosio::name{patient.text}.value;
+      return 0;
+   }
+
+   bool read_action(const json_value &entry, eosio::name contract, logged_action &logged, std::set<uint64_t> &accounts)
+   {
+      logged.time = static_cast<uint32_t>(member_of(entry, "time").as_uint());
+      const auto &account = member_of(entry, "account");
+      logged.action.account = account.kind == json_value::STRING ? eosio::name{account.text} : contract;
+      logged.action.name = eosio::name{member_of(entry, "name").text};
+      for (const auto &level : member_of(entry, "authorization").elements)
+      {
+         logged.action.authorization.emplace_back(eosio::name{member_of(level, "actor").text}, eosio::name{member_of(level, "permission").text});
+         accounts.insert(logged.action.authorization.back().actor.value);
+      }
+      std::string data;
+      if (!member_of(entry, "hex_data").as_bytes(data))
+         return false;
+      logged.action.data.assign(data.begin(), data.end());
+
+      const auto &json_data = member_of(entry, "data");
+      collect_accounts(json_data, accounts);
+      if (logged.action.account == contract)
+         logged.patient = patient_of(json_data);
+      return true;
+   }
+
+   /* Valid account name of prefix followed by index in letters */
+   eosio::name account_at(const std::string &prefix, uint32_t index)
+   {
+      std::string name = prefix;
+      for (auto i = 0; i < 6; i++, index /= 26)
+         name += static_cast<char>('a' + index % 26);
+      return eosio::name{name};
+   }
+
+   /* Key of size bytes in the base64 text actions take */
+   std::string key_text(size_t size, uint64_t seed)
+   {
+      std::vector<uint8_t> key(size + 1);
+      key[0] = keys::BINARY_FORMAT;
+      for (size_t i = 1; i <= size; i++)
+         key[i] = static_cast<uint8_t>(seed + i * 31);
+      return keys::encode_text(key);
+   }
+
+   template <typename... Args>
+   logged_action make_action(uint32_t time, eosio::name contract, const std::vector<eosio::name> &signers, eosio::name name, uint64_t patient,
+                             const Args &... args)
+   {
+      std::vector<eosio::permission_level> authorization;
+      for (const auto signer : signers)
+         authorization.emplace_back(signer, eosio::name{"active"});
+      return {time, eosio::action{std::move(authorization), contract, name, std::make_tuple(args...)}, patient};
+   }
+} // namespace
+
+bool load_log(const std::string &path, eosio::name contract, action_log &log, std::string &error)
+{
+   std::ifstream file{path, std::ios::binary};
+   if (!file)
+   {
+      error = "can't open " + path;
+      return false;
+   }
+   const std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+   json_value document;
+   if (!parse_json(json, document, error))
+   {
+      error = path + ": " + error;
+      return false;
+   }
+   if (document.kind != json_value::ARRAY)
+   {
+      error = path + ": log must be an array of actions";
+      return false;
+   }
+   std::set<uint64_t> accounts{contract.value};
+   log.actions.resize(document.elements.size());
+   for (size_t i = 0; i < document.elements.size(); i++)
+   {
+      auto &logged = log.actions[i];
+      if (!read_action(document.elements[i], contract, logged, accounts))
+      {
+         error = path + ": action " + std::to_string(i) + " has no hex_data of packed arguments";
+         return false;
+      }
+      if (i > 0 && logged.time < log.actions[i - 1].time)
+      {
+         error = path + ": action " + std::to_string(i) + " is older than the action before it";
+         return false;
+      }
+   }
+   accounts.erase(contract.value);
+   for (const auto account : accounts)
+      log.accounts.emplace_back(account);
+   return true;
+}
+
+action_log generate_log(eosio::name contract, uint32_t patients, uint32_t doctors, size_t actions, uint64_t seed)
+{
+   static constexpr uint8_t SPECIALTIES = 8;
+   static constexpr uint32_t DAY_SEC = 24 * 3600;
+   /* DER encoded RSA-2048 public key and ciphertext of RSA-2048 */
+   static constexpr size_t PUBLIC_KEY_SIZE = 294;
+   static constexpr size_t CIPHERTEXT_SIZE = 256;
+
+   std::mt19937_64 random{seed};
+   action_log log;
+   log.actions.reserve(actions + patients + doctors + 3);
+   uint32_t time = 1600000000;
+
+   /* Deployment, then registrations, as after a fresh start */
+   for (const auto setup : {"loadrights", "begloaddspcs", "fnshloadspcs"})
+      log.actions.push_back(make_action(time, contract, {contract}, eosio::name{setup}, 0));
+   for (uint32_t doctor = 0; doctor < doctors; doctor++)
+   {
+      const auto account = account_at("doc", doctor);
+      log.accounts.push_back(account);
+      log.actions.push_back(make_action(time, contract, {contract, account}, eosio::name{"upsertdoc"}, 0, account,
+                                        static_cast<uint8_t>(doctor % SPECIALTIES), key_text(PUBLIC_KEY_SIZE, doctor)));
+   }
+   for (uint32_t patient = 0; patient < patients; patient++)
+   {
+      const auto account = account_at("pat", patient);
+      log.accounts.push_back(account);
+      log.actions.push_back(make_action(time, contract, {contract, account}, eosio::name{"upsertpat"}, account.value, account,
+                                        key_text(PUBLIC_KEY_SIZE, patient)));
+   }
+
+   /* Permission ids the generator expects each patient to have granted, so that most updates and removals are valid */
+   std::vector<std::vector<std::pair<uint32_t, uint64_t>>> granted(patients);
+   std::vector<uint64_t> next_permid(patients, 0);
+
+   for (size_t i = 0; i < actions; i++)
+   {
+      time += static_cast<uint32_t>(random() % 3);
+      const auto patient = static_cast<uint32_t>(random() % patients);
+      const auto dice = random() % 10000;
+      /* Reads and writes mostly come from doctors the patient granted something to */
+      auto doctor = static_cast<uint32_t>(random() % doctors);
+      if (dice < 7000 && !granted[patient].empty() && random() % 5 != 0)
+         doctor = granted[patient][random() % granted[patient].size()].first;
+
+      const auto patient_account = account_at("pat", patient);
+      const auto doctor_account = account_at("doc", doctor);
+      const medical::perm_info perm{patient_account, doctor_account};
+
+      if (dice < 3500)
+      {
+         const medical::record_info record{std::to_string(random()), "visit"};
+         log.actions.push_back(make_action(time, contract, {doctor_account}, eosio::name{"writerecord"}, patient_account.value, perm,
+                                           static_cast<uint8_t>(doctor % SPECIALTIES), record));
+      }
+      else if (dice < 7000)
+      {
+         std::vector<uint8_t> specialtyids;
+         for (auto count = 1 + random() % 2; count > 0; count--)
+            if (const uint8_t specialtyid = random() % SPECIALTIES; std::find(specialtyids.begin(), specialtyids.end(), specialtyid) == specialtyids.end())
+               specialtyids.push_back(specialtyid);
+         const medical::interval interval{time - 30 * DAY_SEC, time};
+         log.actions.push_back(make_action(time, contract, {doctor_account}, eosio::name{"readrecords"}, patient_account.value, perm, specialtyids,
+                                           interval, uint64_t{0}));
+      }
+      else if (dice < 8500 || granted[patient].empty())
+      {
+         const auto rightid = static_cast<uint8_t>(random() % 3);
+         std::vector<uint8_t> specialtyids;
+         if (rightid == medical::right::READ)
+         {
+            for (auto count = 1 + random() % 3; count > 0; count--)
+               if (const uint8_t specialtyid = random() % SPECIALTIES;
+                   std::find(specialtyids.begin(), specialtyids.end(), specialtyid) == specialtyids.end())
+                  specialtyids.push_back(specialtyid);
+         }
+         else
+         {
+            specialtyids.push_back(doctor % SPECIALTIES);
+         }
+         medical::interval interval{0, 0};
+         if (random() % 2 == 0)
+            interval = {time, time + static_cast<uint32_t>(1 + random() % 30) * DAY_SEC};
+         log.actions.push_back(make_action(time, contract, {patient_account}, eosio::name{"addperm"}, patient_account.value, perm, specialtyids,
+                                           rightid, interval, key_text(CIPHERTEXT_SIZE, patient)));
+         granted[patient].emplace_back(doctor, next_permid[patient]++);
+      }
+      else if (dice < 9000)
+      {
+         /* Widen a granted permission to reading every specialty forever */
+         const auto &[grantee, permid] = granted[patient][random() % granted[patient].size()];
+         std::vector<uint8_t> specialtyids;
+         for (uint8_t specialtyid = 0; specialtyid < SPECIALTIES; specialtyid++)
+            specialtyids.push_back(specialtyid);
+         log.actions.push_back(make_action(time, contract, {patient_account}, eosio::name{"updtperm"}, patient_account.value,
+                                           medical::perm_info{patient_account, account_at("doc", grantee)}, permid, specialtyids,
+                                           static_cast<uint8_t>(medical::right::READ), medical::interval{0, 0}));
+      }
+      else if (dice < 9500)
+      {
+         const auto index = random() % granted[patient].size();
+         log.actions.push_back(make_action(time, contract, {patient_account}, eosio::name{"rmperm"}, patient_account.value,
+                                           medical::perm_info{patient_account, account_at("doc", granted[patient][index].first)},
+                                           granted[patient][index].second));
+         granted[patient].erase(granted[patient].begin() + index);
+      }
+      else if (dice < 9950)
+      {
+         log.actions.push_back(make_action(time, contract, {patient_account}, eosio::name{"upsertpat"}, patient_account.value, patient_account,
+                                           key_text(PUBLIC_KEY_SIZE, random())));
+      }
+      else if (dice < 9965)
+      {
+         log.actions.push_back(make_action(time, contract, {doctor_account}, eosio::name{"upsertdoc"}, 0, doctor_account,
+                                           static_cast<uint8_t>(doctor % SPECIALTIES), key_text(PUBLIC_KEY_SIZE, random())));
+      }
+      else if (dice < 9995)
+      {
+         log.actions.push_back(make_action(time, contract, {contract}, eosio::name{"rmpatient"}, patient_account.value, patient_account));
+         granted[patient].clear();
+         next_permid[patient] = 0;
+      }
+      else
+      {
+         log.actions.push_back(make_action(time, contract, {contract}, eosio::name{"rmdoctor"}, 0, doctor_account));
+      }
+   }
+   return log;
+}
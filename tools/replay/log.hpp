@@ -0,0 +1,34 @@
+#pragma once
+#include <eosiolib/action.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Recorded transaction of a single contract action */
+struct logged_action
+{
+   /* Block time the action was executed at */
+   uint32_t time = 0;
+   eosio::action action;
+   /* Patient whose tables the action works on, 0 for actions on doctors, groups or the whole contract, run between barriers */
+   uint64_t patient = 0;
+};
+
+struct action_log
+{
+   /* Actions in execution order, their times never go back */
+   std::vector<logged_action> actions;
+   /* Accounts which sign actions or are named by them as patients, doctors or institutions, created before the replay */
+   std::vector<eosio::name> accounts;
+};
+
+/*
+   Loads log from JSON array of {"time": <sec>, "account": <contract>, "name": <action>, "authorization": [{"actor": <account>,
+   "permission": <permission>}], "data": <action data>, "hex_data": <packed action data>} objects, as action traces print
+   them, in execution order. Account defaults to the given contract; log is replayed on a fresh deployment, so it must
+   start with loadrights, begloaddspcs and fnshloadspcs
+*/
+bool load_log(const std::string &path, eosio::name contract, action_log &log, std::string &error);
+
+/* Synthetic workload of a fresh deployment: registrations, permission changes, writes and reads over the given accounts */
+action_log generate_log(eosio::name contract, uint32_t patients, uint32_t doctors, size_t actions, uint64_t seed);
@@ -0,0 +1,133 @@
+#include "engine.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+/*
+   Deterministic replay of recorded contract actions, for capacity planning
+   Runs the contract itself on the host chain of shardsim: replays log serially, then partitioned by patient on 1, 2, 4,
+   ... threads, checks that every parallel replay ends with tables and deferred transactions byte identical to the
+   serial one and reports throughput of each thread count
+*/
+namespace
+{
+   void usage()
+   {
+      std::fprintf(stderr,
+                   "usage: replay (--log <actions.json> | --generate <patients> <doctors> <actions>) [--seed <n>]\n"
+                   "              [--contract <account>] [--threads <max>] [--state <file>]\n"
+                   "  log is replayed on a fresh deployment of the contract, every action through its apply entry point;\n"
+                   "  --state writes the final table encoding of the serial replay\n");
+   }
+
+   /* FNV-1a, only to print a short fingerprint of the state */
+   uint64_t fingerprint(const std::string &bytes)
+   {
+      uint64_t hash = 14695981039346656037ull;
+      for (const auto c : bytes)
+         hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+      return hash;
+   }
+
+   template <typename Function>
+   double measure(Function &&function)
+   {
+      const auto started = std::chrono::steady_clock::now();
+      function();
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+   }
+} // namespace
+
+int main(int argc, char **argv)
+{
+   std::string log_path, state_path, contract = "medical";
+   uint32_t patients = 0, doctors = 0;
+   size_t actions = 0;
+   uint64_t seed = 1;
+   auto max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+   for (auto i = 1; i < argc; i++)
+   {
+      const std::string arg = argv[i];
+      if (arg == "--log" && i + 1 < argc)
+         log_path = argv[++i];
+      else if (arg == "--generate" && i + 3 < argc)
+      {
+         patients = static_cast<uint32_t>(std::stoul(argv[++i]));
+         doctors = static_cast<uint32_t>(std::stoul(argv[++i]));
+         actions = std::stoull(argv[++i]);
+      }
+      else if (arg == "--seed" && i + 1 < argc)
+         seed = std::stoull(argv[++i]);
+      else if (arg == "--contract" && i + 1 < argc)
+         contract = argv[++i];
+      else if (arg == "--threads" && i + 1 < argc)
+         max_threads = std::max(static_cast<unsigned>(std::stoul(argv[++i])), 1u);
+      else if (arg == "--state" && i + 1 < argc)
+         state_path = argv[++i];
+      else
+      {
+         usage();
+         return 2;
+      }
+   }
+   if (log_path.empty() == (patients == 0 || doctors == 0))
+   {
+      usage();
+      return 2;
+   }
+
+   action_log log;
+   if (!log_path.empty())
+   {
+      std::string error;
+      if (!load_log(log_path, eosio::name{contract}, log, error))
+      {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         return 1;
+      }
+   }
+   else
+   {
+      log = generate_log(eosio::name{contract}, patients, doctors, actions, seed);
+   }
+   const auto start_time = log.actions.empty() ? 0 : log.actions.front().time;
+
+   shardsim::chain serial_chain{start_time};
+   replay::deploy(serial_chain, eosio::name{contract}, log);
+   replay::stats serial_stats;
+   const auto serial_seconds = measure([&]() { serial_stats = replay::replay_serial(serial_chain, log); });
+   const auto expected = serial_chain.serialize();
+   std::printf("actions=%zu applied=%llu rejected=%llu state=%016llx\n", log.actions.size(),
+               static_cast<unsigned long long>(serial_stats.applied), static_cast<unsigned long long>(serial_stats.rejected),
+               static_cast<unsigned long long>(fingerprint(expected)));
+   std::printf("serial     %8.3fs %12.0f actions/s\n", serial_seconds, log.actions.size() / serial_seconds);
+
+   if (!state_path.empty())
+   {
+      std::ofstream file{state_path, std::ios::binary};
+      if (!file.write(expected.data(), expected.size()))
+      {
+         std::fprintf(stderr, "can't write %s\n", state_path.c_str());
+         return 1;
+      }
+   }
+
+   auto diverged = false;
+   for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads))
+   {
+      replay::work_stealing_pool pool{threads};
+      shardsim::chain chain{start_time};
+      replay::deploy(chain, eosio::name{contract}, log);
+      size_t epochs = 0, reruns = 0;
+      replay::stats stats;
+      const auto seconds = measure([&]() { stats = replay::replay_parallel(chain, log, pool, epochs, reruns); });
+      const auto identical = chain.serialize() == expected && stats.applied == serial_stats.applied;
+      diverged |= !identical;
+      std::printf("threads=%-3u %8.3fs %12.0f actions/s speedup=%.2fx epochs=%zu reruns=%zu %s\n", threads, seconds,
+                  log.actions.size() / seconds, serial_seconds / seconds, epochs, reruns, identical ? "identical" : "DIVERGED");
+      if (threads == max_threads)
+         break;
+   }
+   return diverged ? 1 : 0;
+}
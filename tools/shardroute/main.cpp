@@ -0,0 +1,92 @@
+#include "name.hpp"
+#include "sharding.hpp"
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+   Off-chain router of a sharded deployment
+   Prints shard contract each patient is assigned to, computed with the same hash the contracts use,
+   and optionally the patients which would move if a shard was appended to the deployment
+*/
+namespace
+{
+   void usage()
+   {
+      std::fprintf(stderr,
+                   "usage: shardroute --shards <shard,shard,...> [--append <shard>] [patient...]\n"
+                   "  patients are read from standard input when none are given\n");
+   }
+
+   std::vector<std::string> split(const std::string &list)
+   {
+      std::vector<std::string> items;
+      std::stringstream stream{list};
+      for (std::string item; std::getline(stream, item, ',');)
+         if (!item.empty())
+            items.push_back(item);
+      return items;
+   }
+} // namespace
+
+int main(int argc, char **argv)
+{
+   std::vector<std::string> shards, patients;
+   std::string appended;
+   for (auto i = 1; i < argc; i++)
+   {
+      const std::string arg = argv[i];
+      if (arg == "--shards" && i + 1 < argc)
+         shards = split(argv[++i]);
+      else if (arg == "--append" && i + 1 < argc)
+         appended = argv[++i];
+      else if (!arg.empty() && arg[0] != '-')
+         patients.push_back(arg);
+      else
+      {
+         usage();
+         return 2;
+      }
+   }
+   if (shards.empty())
+   {
+      usage();
+      return 2;
+   }
+   if (patients.empty())
+      for (std::string patient; std::cin >> patient;)
+         patients.push_back(patient);
+
+   auto grown = shards;
+   if (!appended.empty())
+      grown.push_back(appended);
+
+   std::map<std::string, size_t> load;
+   size_t moved = 0;
+   for (const auto &patient : patients)
+   {
+      const auto account = account_name::from_string(patient);
+      const auto &shard = shards[sharding::shard_of(account, static_cast<uint32_t>(shards.size()))];
+      load[shard]++;
+      if (appended.empty())
+      {
+         std::printf("%s %s\n", patient.c_str(), shard.c_str());
+         continue;
+      }
+      const auto &new_shard = grown[sharding::shard_of(account, static_cast<uint32_t>(grown.size()))];
+      if (new_shard != shard)
+      {
+         std::printf("%s %s -> %s\n", patient.c_str(), shard.c_str(), new_shard.c_str());
+         moved++;
+      }
+   }
+
+   for (const auto &shard : shards)
+      std::fprintf(stderr, "%s: %zu patients\n", shard.c_str(), load[shard]);
+   if (!appended.empty())
+      std::fprintf(stderr, "appending %s moves %zu of %zu patients\n", appended.c_str(), moved, patients.size());
+   return 0;
+}
@@ -0,0 +1,834 @@
+#include "chain.hpp"
+#include <eosiolib/transaction.hpp>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <stdexcept>
+
+namespace
+{
+   /* Failed eosio_assert, unwinds the contract up to the transaction being applied */
+   struct assertion_failure : std::runtime_error
+   {
+      using std::runtime_error::runtime_error;
+   };
+
+   constexpr unsigned MAX_INLINE_DEPTH = 4;
+
+   struct table_id
+   {
+      uint64_t code;
+      uint64_t scope;
+      uint64_t table;
+
+      bool operator<(const table_id &other) const noexcept
+      {
+         return std::tie(code, scope, table) < std::tie(other.code, other.scope, other.table);
+      }
+   };
+
+   using row_key = std::pair<table_id, uint64_t>;
+
+   struct row
+   {
+      uint64_t payer;
+      std::vector<char> data;
+   };
+
+   using deferred_key = std::pair<uint64_t, uint128_t>;
+
+   struct deferred_transaction
+   {
+      uint64_t sender;
+      uint128_t sender_id;
+      uint32_t due;
+      /* Order of sending, transactions due at the same time run in this order */
+      uint64_t sequence;
+      std::vector<eosio::action> actions;
+   };
+
+   struct action_context
+   {
+      const eosio::action *action;
+      std::vector<eosio::action> inlines;
+      std::string console;
+   };
+} // namespace
+
+namespace shardsim
+{
+   /*
+      Chain of its own, or a fork or a transaction layered over another chain
+      Layer holds only what it wrote over its base, rows and deferred transactions it erased stay as empty entries
+   */
+   struct chain::state
+   {
+      /* Chain this one continues from, nullptr for a chain of its own */
+      const state *base = nullptr;
+      std::map<uint64_t, apply_function> accounts;
+      std::map<table_id, std::map<uint64_t, std::optional<row>>> tables;
+      std::map<deferred_key, std::optional<deferred_transaction>> deferred;
+      /* Deferred transactions pending in this layer, in the order they run */
+      std::set<std::tuple<uint32_t, uint64_t, deferred_key>> schedule;
+      uint64_t deferred_sequence = 0;
+      uint64_t time_us = 0;
+
+      /* Reads are recorded by forks, and by transactions run on them */
+      bool tracked = false;
+      std::set<row_key> read_rows;
+      /* Tables iterated, every row of them may have affected the reader */
+      std::set<table_id> scanned_tables;
+      std::set<deferred_key> read_deferred;
+
+      action_context *context = nullptr;
+      /* Chain iterators of rows handed to contracts, one per row */
+      std::vector<row_key> iterators;
+      std::map<row_key, int32_t> iterator_ids;
+      /* Tables of end iterators, end iterator of table at index i is -(i + 2) */
+      std::vector<table_id> end_tables;
+   };
+
+   struct chain_access
+   {
+      static chain::state &state_of(chain &used) noexcept { return *used.m_state; }
+      static const chain::state &state_of(const chain &used) noexcept { return *used.m_state; }
+   };
+} // namespace shardsim
+
+namespace
+{
+   using shardsim::chain;
+   using shardsim::chain_access;
+
+   thread_local chain::state *t_current = nullptr;
+
+   chain::state &current()
+   {
+      if (t_current == nullptr)
+      {
+         /* Chain every thread starts with */
+         thread_local chain own;
+         t_current = &chain_access::state_of(own);
+      }
+      return *t_current;
+   }
+
+   [[noreturn]] void fail(const std::string &message)
+   {
+      throw assertion_failure{message};
+   }
+
+   action_context &context()
+   {
+      if (current().context == nullptr)
+         fail("intrinsic can be called only by a contract executing an action");
+      return *current().context;
+   }
+
+   uint64_t receiver()
+   {
+      return context().action->account.value;
+   }
+
+   std::optional<shardsim::apply_function> find_account(const chain::state &state, uint64_t account)
+   {
+      for (auto level = &state; level != nullptr; level = level->base)
+      {
+         if (const auto account_iter = level->accounts.find(account); account_iter != level->accounts.end())
+            return account_iter->second;
+      }
+      return std::nullopt;
+   }
+
+   /* Row as the chain sees it through its layers, nullptr if there is none */
+   const row *find_row(const chain::state &state, const row_key &key)
+   {
+      for (auto level = &state; level != nullptr; level = level->base)
+      {
+         const auto table_iter = level->tables.find(key.first);
+         if (table_iter == level->tables.end())
+            continue;
+         if (const auto row_iter = table_iter->second.find(key.second); row_iter != table_iter->second.end())
+            return row_iter->second ? &*row_iter->second : nullptr;
+      }
+      return nullptr;
+   }
+
+   /* Smallest primary key from the given one on which has a row */
+   std::optional<uint64_t> first_row(const chain::state &state, const table_id &id, uint64_t from)
+   {
+      for (;;)
+      {
+         std::optional<uint64_t> candidate;
+         for (auto level = &state; level != nullptr; level = level->base)
+         {
+            const auto table_iter = level->tables.find(id);
+            if (table_iter == level->tables.end())
+               continue;
+            const auto row_iter = table_iter->second.lower_bound(from);
+            if (row_iter != table_iter->second.end() && (!candidate || row_iter->first < *candidate))
+               candidate = row_iter->first;
+         }
+         if (!candidate || find_row(state, {id, *candidate}) != nullptr)
+            return candidate;
+         /* Row was erased by a layer over the one which has it */
+         if (*candidate == UINT64_MAX)
+            return std::nullopt;
+         from = *candidate + 1;
+      }
+   }
+
+   /* Greatest primary key below the given one, or of the whole table if none is given, which has a row */
+   std::optional<uint64_t> last_row(const chain::state &state, const table_id &id, std::optional<uint64_t> below)
+   {
+      for (;;)
+      {
+         std::optional<uint64_t> candidate;
+         for (auto level = &state; level != nullptr; level = level->base)
+         {
+            const auto table_iter = level->tables.find(id);
+            if (table_iter == level->tables.end())
+               continue;
+            const auto &rows = table_iter->second;
+            const auto row_iter = below ? rows.lower_bound(*below) : rows.end();
+            if (row_iter != rows.begin() && (!candidate || std::prev(row_iter)->first > *candidate))
+               candidate = std::prev(row_iter)->first;
+         }
+         if (!candidate || find_row(state, {id, *candidate}) != nullptr)
+            return candidate;
+         below = candidate;
+      }
+   }
+
+   void write_row(chain::state &state, const row_key &key, std::optional<row> value)
+   {
+      if (value || state.base != nullptr)
+      {
+         state.tables[key.first][key.second] = std::move(value);
+         return;
+      }
+      if (const auto table_iter = state.tables.find(key.first); table_iter != state.tables.end())
+      {
+         table_iter->second.erase(key.second);
+         if (table_iter->second.empty())
+            state.tables.erase(table_iter);
+      }
+   }
+
+   const deferred_transaction *find_deferred(const chain::state &state, const deferred_key &key)
+   {
+      for (auto level = &state; level != nullptr; level = level->base)
+      {
+         if (const auto deferred_iter = level->deferred.find(key); deferred_iter != level->deferred.end())
+            return deferred_iter->second ? &*deferred_iter->second : nullptr;
+      }
+      return nullptr;
+   }
+
+   void write_deferred(chain::state &state, const deferred_key &key, std::optional<deferred_transaction> value)
+   {
+      const auto deferred_iter = state.deferred.find(key);
+      if (deferred_iter != state.deferred.end() && deferred_iter->second)
+         state.schedule.erase({deferred_iter->second->due, deferred_iter->second->sequence, key});
+      if (value)
+         state.schedule.emplace(value->due, value->sequence, key);
+      if (value || state.base != nullptr)
+         state.deferred[key] = std::move(value);
+      else if (deferred_iter != state.deferred.end())
+         state.deferred.erase(deferred_iter);
+   }
+
+   /* Pending deferred transaction which runs first, nullptr if there is none */
+   const deferred_transaction *next_deferred(const chain::state &state)
+   {
+      const deferred_transaction *first = nullptr;
+      for (auto level = &state; level != nullptr; level = level->base)
+      {
+         for (const auto &[due, sequence, key] : level->schedule)
+         {
+            if (first != nullptr && std::tie(first->due, first->sequence) < std::tie(due, sequence))
+               break;
+            /* Layers over this one may have replaced or cancelled it */
+            auto overridden = false;
+            for (auto upper = &state; upper != level && !overridden; upper = upper->base)
+               overridden = upper->deferred.count(key) != 0;
+            if (!overridden)
+            {
+               first = &*level->deferred.at(key);
+               break;
+            }
+         }
+      }
+      return first;
+   }
+
+   void merge_reads(chain::state &state, const chain::state &layer)
+   {
+      if (!state.tracked)
+         return;
+      state.read_rows.insert(layer.read_rows.begin(), layer.read_rows.end());
+      state.scanned_tables.insert(layer.scanned_tables.begin(), layer.scanned_tables.end());
+      state.read_deferred.insert(layer.read_deferred.begin(), layer.read_deferred.end());
+   }
+
+   /* Applies writes of a layer over the state to it */
+   void merge_layer(chain::state &state, const chain::state &layer)
+   {
+      for (const auto &[id, rows] : layer.tables)
+      {
+         for (const auto &[primary, value] : rows)
+            write_row(state, {id, primary}, value);
+      }
+      for (const auto &[key, value] : layer.deferred)
+         write_deferred(state, key, value);
+      for (const auto &[account, contract] : layer.accounts)
+         state.accounts[account] = contract;
+      state.deferred_sequence = std::max(state.deferred_sequence, layer.deferred_sequence);
+      merge_reads(state, layer);
+   }
+
+   void read_row(const row_key &key)
+   {
+      if (auto &state = current(); state.tracked)
+         state.read_rows.insert(key);
+   }
+
+   void scan_table(const table_id &id)
+   {
+      if (auto &state = current(); state.tracked)
+         state.scanned_tables.insert(id);
+   }
+
+   void read_deferred(const deferred_key &key)
+   {
+      if (auto &state = current(); state.tracked)
+         state.read_deferred.insert(key);
+   }
+
+   int32_t row_iterator(const row_key &key)
+   {
+      auto &state = current();
+      if (const auto iterator_iter = state.iterator_ids.find(key); iterator_iter != state.iterator_ids.end())
+         return iterator_iter->second;
+      const auto iterator = static_cast<int32_t>(state.iterators.size());
+      state.iterators.push_back(key);
+      state.iterator_ids.emplace(key, iterator);
+      return iterator;
+   }
+
+   int32_t end_iterator(const table_id &id)
+   {
+      auto &end_tables = current().end_tables;
+      auto end_iter = std::find_if(end_tables.begin(), end_tables.end(), [&id](const auto &table) {
+         return !(table < id) && !(id < table);
+      });
+      if (end_iter == end_tables.end())
+         end_iter = end_tables.insert(end_iter, id);
+      return -static_cast<int32_t>(end_iter - end_tables.begin()) - 2;
+   }
+
+   /* Row at iterator, or end of table at the next one, or -1 when table is empty */
+   int32_t iterator_at(const table_id &id, std::optional<uint64_t> primary)
+   {
+      if (primary)
+         return row_iterator({id, *primary});
+      return first_row(current(), id, 0) ? end_iterator(id) : -1;
+   }
+
+   const row_key &iterated_row(int32_t iterator)
+   {
+      const auto &iterators = current().iterators;
+      if (iterator < 0 || static_cast<size_t>(iterator) >= iterators.size())
+         fail("invalid database iterator");
+      return iterators[iterator];
+   }
+
+   const row &existing_row(int32_t iterator)
+   {
+      const auto existing = find_row(current(), iterated_row(iterator));
+      if (existing == nullptr)
+         fail("database iterator points to a removed row");
+      return *existing;
+   }
+
+   void check_authorization(const eosio::action &sent)
+   {
+      /* Contract may use its own authority through eosio.code, or authorities the current action carries */
+      const auto &current_action = *context().action;
+      for (const auto &level : sent.authorization)
+      {
+         const auto authorized = level.actor == current_action.account ||
+                                 std::any_of(current_action.authorization.begin(), current_action.authorization.end(), [&level](const auto &granted) {
+                                    return granted.actor == level.actor;
+                                 });
+         if (!authorized)
+            fail("action " + sent.name.to_string() + " is authorized by " + level.actor.to_string() + ", which didn't authorize " +
+                 current_action.name.to_string());
+      }
+   }
+
+   void execute(const eosio::action &action, unsigned depth, shardsim::receipt &result)
+   {
+      if (depth > MAX_INLINE_DEPTH)
+         fail("max inline action depth per transaction reached");
+      const auto contract = find_account(current(), action.account.value);
+      if (!contract)
+         fail("action " + action.name.to_string() + " sent to account " + action.account.to_string() + " which doesn't exist");
+
+      action_context executed{&action, {}, {}};
+      auto &state = current();
+      const auto previous = state.context;
+      state.context = &executed;
+      try
+      {
+         if (*contract != nullptr)
+            (*contract)(action.account.value, action.account.value, action.name.value);
+      }
+      catch (...)
+      {
+         state.context = previous;
+         throw;
+      }
+      state.context = previous;
+
+      result.console.push_back(std::move(executed.console));
+      for (const auto &sent : executed.inlines)
+         execute(sent, depth + 1, result);
+   }
+
+   void append(std::string &bytes, uint64_t value)
+   {
+      for (auto i = 0; i < 8; i++, value >>= 8)
+         bytes += static_cast<char>(value & 0xFF);
+   }
+} // namespace
+
+namespace shardsim
+{
+   chain::chain(uint32_t time) : m_state{std::make_unique<state>()}
+   {
+      m_state->time_us = static_cast<uint64_t>(time) * 1000000;
+   }
+
+   chain::~chain() = default;
+
+   std::unique_ptr<chain> chain::fork() const
+   {
+      auto forked = std::make_unique<chain>();
+      auto &forked_state = *forked->m_state;
+      forked_state.base = m_state.get();
+      forked_state.tracked = true;
+      forked_state.deferred_sequence = m_state->deferred_sequence;
+      forked_state.time_us = m_state->time_us;
+      return forked;
+   }
+
+   void chain::merge(const chain &fork)
+   {
+      if (fork.m_state->base != m_state.get())
+         throw std::invalid_argument{"merged chain is not a fork of this chain"};
+      merge_layer(*m_state, *fork.m_state);
+   }
+
+   std::string chain::serialize() const
+   {
+      std::set<table_id> ids;
+      std::set<deferred_key> keys;
+      for (const state *level = m_state.get(); level != nullptr; level = level->base)
+      {
+         for (const auto &[id, rows] : level->tables)
+            ids.insert(id);
+         for (const auto &[key, deferred] : level->deferred)
+            keys.insert(key);
+      }
+
+      std::string bytes;
+      for (const auto &id : ids)
+      {
+         for (auto primary = first_row(*m_state, id, 0); primary; primary = *primary == UINT64_MAX ? std::nullopt : first_row(*m_state, id, *primary + 1))
+         {
+            const auto &stored = *find_row(*m_state, {id, *primary});
+            for (const auto value : {id.code, id.scope, id.table, *primary, stored.payer, static_cast<uint64_t>(stored.data.size())})
+               append(bytes, value);
+            bytes.append(stored.data.begin(), stored.data.end());
+         }
+      }
+      for (const auto &key : keys)
+      {
+         const auto pending = find_deferred(*m_state, key);
+         if (pending == nullptr)
+            continue;
+         const auto actions = eosio::pack(pending->actions);
+         for (const auto value : {pending->sender, static_cast<uint64_t>(pending->sender_id >> 64), static_cast<uint64_t>(pending->sender_id),
+                                  static_cast<uint64_t>(pending->due), pending->sequence, static_cast<uint64_t>(actions.size())})
+            append(bytes, value);
+         bytes.append(actions.begin(), actions.end());
+      }
+      return bytes;
+   }
+
+   current_chain::current_chain(chain &used) : m_previous{t_current}
+   {
+      t_current = &chain_access::state_of(used);
+   }
+
+   current_chain::~current_chain()
+   {
+      t_current = m_previous;
+   }
+
+   std::vector<std::vector<size_t>> conflicting_forks(const std::vector<const chain *> &forks)
+   {
+      std::vector<size_t> parents(forks.size());
+      std::iota(parents.begin(), parents.end(), 0);
+      const auto root = [&parents](size_t fork) {
+         while (parents[fork] != fork)
+            fork = parents[fork] = parents[parents[fork]];
+         return fork;
+      };
+      const auto join = [&parents, &root](size_t first, size_t second) { parents[root(first)] = root(second); };
+
+      /* Writers of every row, table and deferred transaction; forks writing the same one conflict right away */
+      std::map<row_key, size_t> row_writers;
+      std::map<table_id, std::vector<size_t>> table_writers;
+      std::map<deferred_key, size_t> deferred_writers;
+      for (size_t fork = 0; fork < forks.size(); fork++)
+      {
+         const auto &state = chain_access::state_of(*forks[fork]);
+         for (const auto &[id, rows] : state.tables)
+         {
+            table_writers[id].push_back(fork);
+            for (const auto &[primary, value] : rows)
+            {
+               if (const auto [writer_iter, inserted] = row_writers.emplace(row_key{id, primary}, fork); !inserted)
+                  join(fork, writer_iter->second);
+            }
+         }
+         for (const auto &[key, value] : state.deferred)
+         {
+            if (const auto [writer_iter, inserted] = deferred_writers.emplace(key, fork); !inserted)
+               join(fork, writer_iter->second);
+         }
+      }
+
+      /* Readers of what another fork wrote */
+      for (size_t fork = 0; fork < forks.size(); fork++)
+      {
+         const auto &state = chain_access::state_of(*forks[fork]);
+         for (const auto &key : state.read_rows)
+         {
+            if (const auto writer_iter = row_writers.find(key); writer_iter != row_writers.end())
+               join(fork, writer_iter->second);
+         }
+         for (const auto &id : state.scanned_tables)
+         {
+            if (const auto writers_iter = table_writers.find(id); writers_iter != table_writers.end())
+            {
+               for (const auto writer : writers_iter->second)
+                  join(fork, writer);
+            }
+         }
+         for (const auto &key : state.read_deferred)
+         {
+            if (const auto writer_iter = deferred_writers.find(key); writer_iter != deferred_writers.end())
+               join(fork, writer_iter->second);
+         }
+      }
+
+      std::vector<std::vector<size_t>> groups;
+      std::map<size_t, size_t> group_of;
+      for (size_t fork = 0; fork < forks.size(); fork++)
+      {
+         const auto [group_iter, inserted] = group_of.emplace(root(fork), groups.size());
+         if (inserted)
+            groups.emplace_back();
+         groups[group_iter->second].push_back(fork);
+      }
+      return groups;
+   }
+
+   void create_account(eosio::name account, apply_function contract)
+   {
+      current().accounts[account.value] = contract;
+   }
+
+   receipt push(const std::vector<eosio::action> &actions)
+   {
+      /* Transaction writes a layer of its own, which is merged into the chain only if every action succeeds */
+      auto &parent = current();
+      chain::state transaction;
+      transaction.base = &parent;
+      transaction.tracked = parent.tracked;
+      transaction.deferred_sequence = parent.deferred_sequence;
+      transaction.time_us = parent.time_us;
+
+      receipt result;
+      t_current = &transaction;
+      try
+      {
+         for (const auto &action : actions)
+            execute(action, 0, result);
+         result.applied = true;
+      }
+      catch (const assertion_failure &failure)
+      {
+         result.error = failure.what();
+      }
+      catch (...)
+      {
+         t_current = &parent;
+         throw;
+      }
+      t_current = &parent;
+
+      /* Reads of a failed transaction count too, its failure may depend on them */
+      if (result.applied)
+         merge_layer(parent, transaction);
+      else
+         merge_reads(parent, transaction);
+      return result;
+   }
+
+   std::vector<receipt> advance(uint32_t seconds)
+   {
+      auto &state = current();
+      state.time_us += static_cast<uint64_t>(seconds) * 1000000;
+      std::vector<receipt> receipts;
+      for (;;)
+      {
+         const auto due = next_deferred(state);
+         if (due == nullptr || due->due > now())
+            return receipts;
+         const auto actions = due->actions;
+         write_deferred(state, {due->sender, due->sender_id}, std::nullopt);
+         receipts.push_back(push(actions));
+      }
+   }
+
+   uint32_t now()
+   {
+      return static_cast<uint32_t>(current().time_us / 1000000);
+   }
+
+   void set_clock(uint32_t time)
+   {
+      auto &state = current();
+      state.time_us = std::max(state.time_us, static_cast<uint64_t>(time) * 1000000);
+   }
+
+   uint32_t next_due()
+   {
+      const auto due = next_deferred(current());
+      return due == nullptr ? UINT32_MAX : due->due;
+   }
+
+   void set_deferred_sequence(uint64_t sequence)
+   {
+      current().deferred_sequence = sequence;
+   }
+} // namespace shardsim
+
+extern "C"
+{
+   void eosio_assert(uint32_t test, const char *msg)
+   {
+      if (!test)
+         fail(msg);
+   }
+
+   uint64_t current_time()
+   {
+      return current().time_us;
+   }
+
+   int cancel_deferred(const uint128_t &sender_id)
+   {
+      const auto key = std::make_pair(receiver(), sender_id);
+      read_deferred(key);
+      if (find_deferred(current(), key) == nullptr)
+         return 0;
+      write_deferred(current(), key, std::nullopt);
+      return 1;
+   }
+
+   void send_deferred(const uint128_t &sender_id, uint64_t payer, const char *serialized_transaction, size_t size, uint32_t replace_existing)
+   {
+      (void)payer;
+      auto transaction = eosio::unpack<eosio::transaction>(serialized_transaction, size);
+      for (const auto &action : transaction.actions)
+         check_authorization(action);
+      const auto key = std::make_pair(receiver(), sender_id);
+      read_deferred(key);
+      if (find_deferred(current(), key) != nullptr && !replace_existing)
+         fail("deferred transaction with the same sender_id and payer already exists");
+      auto &state = current();
+      write_deferred(state, key, deferred_transaction{receiver(), sender_id, now() + transaction.delay_sec, state.deferred_sequence++, std::move(transaction.actions)});
+   }
+
+   int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void *data, uint32_t len)
+   {
+      const row_key stored{{receiver(), scope, table}, id};
+      read_row(stored);
+      if (find_row(current(), stored) != nullptr)
+         fail("could not insert object, most likely a uniqueness constraint was violated");
+      const auto bytes = static_cast<const char *>(data);
+      write_row(current(), stored, row{payer == 0 ? receiver() : payer, std::vector<char>(bytes, bytes + len)});
+      return row_iterator(stored);
+   }
+
+   void db_update_i64(int32_t iterator, uint64_t payer, const void *data, uint32_t len)
+   {
+      const auto key = iterated_row(iterator);
+      if (key.first.code != receiver())
+         fail("db access violation");
+      auto updated = existing_row(iterator);
+      const auto bytes = static_cast<const char *>(data);
+      updated.data.assign(bytes, bytes + len);
+      if (payer != 0)
+         updated.payer = payer;
+      write_row(current(), key, std::move(updated));
+   }
+
+   void db_remove_i64(int32_t iterator)
+   {
+      const auto key = iterated_row(iterator);
+      if (key.first.code != receiver())
+         fail("db access violation");
+      existing_row(iterator);
+      write_row(current(), key, std::nullopt);
+   }
+
+   int32_t db_get_i64(int32_t iterator, void *data, uint32_t len)
+   {
+      read_row(iterated_row(iterator));
+      const auto &read = existing_row(iterator);
+      const auto size = static_cast<uint32_t>(read.data.size());
+      if (len == 0)
+         return static_cast<int32_t>(size);
+      const auto copied = std::min(len, size);
+      std::memcpy(data, read.data.data(), copied);
+      return static_cast<int32_t>(copied);
+   }
+
+   int32_t db_next_i64(int32_t iterator, uint64_t *primary)
+   {
+      if (iterator < -1)
+         return -1;
+      const auto [id, current_primary] = iterated_row(iterator);
+      scan_table(id);
+      const auto next = current_primary == UINT64_MAX ? std::nullopt : first_row(current(), id, current_primary + 1);
+      if (next)
+         *primary = *next;
+      return iterator_at(id, next);
+   }
+
+   int32_t db_previous_i64(int32_t iterator, uint64_t *primary)
+   {
+      table_id id;
+      std::optional<uint64_t> below;
+      if (iterator < -1)
+      {
+         const auto index = static_cast<size_t>(-iterator - 2);
+         if (index >= current().end_tables.size())
+            fail("invalid database iterator");
+         id = current().end_tables[index];
+      }
+      else
+      {
+         const auto &key = iterated_row(iterator);
+         id = key.first;
+         below = key.second;
+      }
+      scan_table(id);
+      const auto previous = last_row(current(), id, below);
+      if (!previous)
+         return -1;
+      *primary = *previous;
+      return row_iterator({id, *previous});
+   }
+
+   int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id)
+   {
+      /* Missing row gives end iterator even in an empty table, so that finding a row doesn't depend on the others */
+      const row_key found{{code, scope, table}, id};
+      read_row(found);
+      return find_row(current(), found) != nullptr ? row_iterator(found) : end_iterator(found.first);
+   }
+
+   int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id)
+   {
+      const table_id found{code, scope, table};
+      scan_table(found);
+      return iterator_at(found, first_row(current(), found, id));
+   }
+
+   int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id)
+   {
+      const table_id found{code, scope, table};
+      scan_table(found);
+      return iterator_at(found, id == UINT64_MAX ? std::nullopt : first_row(current(), found, id + 1));
+   }
+
+   int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table)
+   {
+      const table_id found{code, scope, table};
+      scan_table(found);
+      return iterator_at(found, std::nullopt);
+   }
+}
+
+namespace eosio::internal_use_do_not_use
+{
+   extern "C"
+   {
+      uint32_t read_action_data(void *msg, uint32_t len)
+      {
+         const auto &data = context().action->data;
+         const auto copied = std::min(len, static_cast<uint32_t>(data.size()));
+         std::memcpy(msg, data.data(), copied);
+         return copied;
+      }
+
+      uint32_t action_data_size()
+      {
+         return static_cast<uint32_t>(context().action->data.size());
+      }
+
+      uint64_t current_receiver()
+      {
+         return receiver();
+      }
+
+      void require_auth(uint64_t name)
+      {
+         if (!has_auth(name))
+            fail("missing authority of " + eosio::name{name}.to_string());
+      }
+
+      bool has_auth(uint64_t name)
+      {
+         const auto &authorization = context().action->authorization;
+         return std::any_of(authorization.begin(), authorization.end(), [name](const auto &level) { return level.actor.value == name; });
+      }
+
+      bool is_account(uint64_t name)
+      {
+         return find_account(current(), name).has_value();
+      }
+
+      void send_inline(const char *serialized_action, size_t size)
+      {
+         auto sent = eosio::unpack<eosio::action>(serialized_action, size);
+         check_authorization(sent);
+         context().inlines.push_back(std::move(sent));
+      }
+
+      void prints_l(const char *text, uint32_t len)
+      {
+         context().console.append(text, len);
+      }
+   }
+} // namespace eosio::internal_use_do_not_use
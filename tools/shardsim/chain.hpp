@@ -0,0 +1,108 @@
+#pragma once
+#include <eosiolib/eosio.hpp>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/*
+   Single node chain running contracts in process
+   Every account may run a contract, given by its apply entry point; transactions are applied atomically, inline actions
+   run after the action which sent them and deferred transactions run once the clock passes their delay
+*/
+namespace shardsim
+{
+   using apply_function = void (*)(uint64_t receiver, uint64_t code, uint64_t action);
+
+   /* Outcome of a transaction */
+   struct receipt
+   {
+      bool applied = false;
+      /* Message of the failed assertion which reverted the transaction */
+      std::string error;
+      /* Console output of every executed action, in execution order */
+      std::vector<std::string> console;
+   };
+
+   /*
+      Accounts, tables, pending deferred transactions and clock of a chain
+      Functions below act on the chain current on the calling thread, every thread starts with a chain of its own
+   */
+   class chain
+   {
+   public:
+      /* Tables and clock, defined by chain.cpp */
+      struct state;
+
+      explicit chain(uint32_t time = 1600000000);
+      chain(const chain &) = delete;
+      chain &operator=(const chain &) = delete;
+      ~chain();
+
+      /*
+         Chain continuing from this one, which reads accounts and tables of this chain and keeps its own writes until
+         they are merged back; this chain must not change while the fork is alive, so forks may run on other threads.
+         Fork records rows and deferred transactions it reads, so that forks run side by side can be checked for conflicts
+      */
+      std::unique_ptr<chain> fork() const;
+
+      /* Applies tables and deferred transactions written by a fork of this chain */
+      void merge(const chain &fork);
+
+      /* Encoding of every table row and pending deferred transaction, equal for chains which hold the same ones */
+      std::string serialize() const;
+
+   private:
+      friend struct chain_access;
+
+      std::unique_ptr<state> m_state;
+   };
+
+   /* Makes chain current on the calling thread while alive */
+   class current_chain
+   {
+   public:
+      explicit current_chain(chain &used);
+      current_chain(const current_chain &) = delete;
+      current_chain &operator=(const current_chain &) = delete;
+      ~current_chain();
+
+   private:
+      chain::state *m_previous;
+   };
+
+   /*
+      Groups of forks of one chain, where every fork read or wrote something another fork of its group wrote
+      Every fork is in exactly one group, forks of different groups can be merged in any order with the same result
+   */
+   std::vector<std::vector<size_t>> conflicting_forks(const std::vector<const chain *> &forks);
+
+   void create_account(eosio::name account, apply_function contract = nullptr);
+
+   /* Applies actions as one transaction, signed by all the actors of their authorizations */
+   receipt push(const std::vector<eosio::action> &actions);
+
+   template <typename... Args>
+   receipt push(eosio::name signer, eosio::name contract, eosio::name action, const Args &... args)
+   {
+      return push({eosio::action{eosio::permission_level{signer, eosio::name{"active"}}, contract, action, std::make_tuple(args...)}});
+   }
+
+   /* Moves clock forward, applying deferred transactions which became due */
+   std::vector<receipt> advance(uint32_t seconds);
+
+   /* Clock in seconds */
+   uint32_t now();
+
+   /* Moves clock forward without applying deferred transactions, which stay pending until the next advance */
+   void set_clock(uint32_t time);
+
+   /* Due time of the earliest pending deferred transaction, UINT32_MAX when there is none */
+   uint32_t next_due();
+
+   /*
+      Sequence of the next deferred transaction sent, deferred transactions due at the same time run in sequence order
+      Sends number them one after another, callers which replay a chain in parts set it to keep the order of a whole run
+   */
+   void set_deferred_sequence(uint64_t sequence);
+} // namespace shardsim
@@ -0,0 +1,65 @@
+#pragma once
+#include "datastream.hpp"
+#include <vector>
+
+namespace eosio
+{
+   struct permission_level
+   {
+      permission_level() = default;
+      permission_level(name a, name p) : actor{a}, permission{p} {}
+
+      auto fields() { return std::tie(actor, permission); }
+      auto fields() const { return std::tie(actor, permission); }
+
+      name actor;
+      name permission;
+   };
+
+   inline void require_auth(name n)
+   {
+      internal_use_do_not_use::require_auth(n.value);
+   }
+
+   inline bool has_auth(name n)
+   {
+      return internal_use_do_not_use::has_auth(n.value);
+   }
+
+   inline bool is_account(name n)
+   {
+      return internal_use_do_not_use::is_account(n.value);
+   }
+
+   /* Action with its arguments packed, sent inline by contracts or pushed in transactions by the host */
+   struct action
+   {
+      action() = default;
+
+      template <typename T>
+      action(const permission_level &auth, eosio::name a, eosio::name n, T &&value)
+          : account{a}, name{n}, authorization{auth}, data{pack(std::forward<T>(value))}
+      {
+      }
+
+      template <typename T>
+      action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T &&value)
+          : account{a}, name{n}, authorization{std::move(auths)}, data{pack(std::forward<T>(value))}
+      {
+      }
+
+      void send() const
+      {
+         const auto bytes = pack(*this);
+         internal_use_do_not_use::send_inline(bytes.data(), bytes.size());
+      }
+
+      auto fields() { return std::tie(account, name, authorization, data); }
+      auto fields() const { return std::tie(account, name, authorization, data); }
+
+      eosio::name account;
+      eosio::name name;
+      std::vector<permission_level> authorization;
+      std::vector<char> data;
+   };
+} // namespace eosio
@@ -0,0 +1,357 @@
+#pragma once
+#include "name.hpp"
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eosio
+{
+   /* Buffer which values are packed into or unpacked from, in the binary format of nodeos */
+   template <typename T>
+   class datastream
+   {
+   public:
+      datastream(T start, size_t size) : m_start{start}, m_pos{start}, m_end{start + size} {}
+
+      bool read(char *data, size_t size)
+      {
+         eosio_assert(size <= remaining(), "datastream attempted to read past the end");
+         std::memcpy(data, m_pos, size);
+         m_pos += size;
+         return true;
+      }
+
+      bool write(const char *data, size_t size)
+      {
+         eosio_assert(size <= remaining(), "datastream attempted to write past the end");
+         std::memcpy(const_cast<char *>(m_pos), data, size);
+         m_pos += size;
+         return true;
+      }
+
+      void skip(size_t size) { m_pos += size; }
+      T pos() const { return m_pos; }
+      size_t tellp() const { return static_cast<size_t>(m_pos - m_start); }
+      size_t remaining() const { return static_cast<size_t>(m_end - m_pos); }
+
+   private:
+      T m_start;
+      T m_pos;
+      T m_end;
+   };
+
+   /* Counts bytes values would be packed into */
+   template <>
+   class datastream<size_t>
+   {
+   public:
+      explicit datastream(size_t init = 0) : m_size{init} {}
+
+      bool write(const char *, size_t size)
+      {
+         m_size += size;
+         return true;
+      }
+
+      void skip(size_t size) { m_size += size; }
+      size_t tellp() const { return m_size; }
+      size_t remaining() const { return 0; }
+
+   private:
+      size_t m_size;
+   };
+
+   /* Variable length unsigned integer, used for sizes of strings and containers */
+   struct unsigned_int
+   {
+      unsigned_int(uint32_t v = 0) : value{v} {}
+      operator uint32_t() const { return value; }
+
+      uint32_t value;
+   };
+
+   namespace reflection
+   {
+      /* Converts to any field type, only in unevaluated contexts */
+      struct any_field
+      {
+         template <typename T>
+         operator T() const;
+      };
+
+      template <typename T, typename Indices, typename = void>
+      struct is_constructible_from : std::false_type
+      {
+      };
+
+      template <typename T, size_t... I>
+      struct is_constructible_from<T, std::index_sequence<I...>, std::void_t<decltype(T{(I, any_field{})...})>> : std::true_type
+      {
+      };
+
+      /* Number of fields of an aggregate, the most initializers it can be brace initialized with */
+      template <typename T, size_t N = 0>
+      constexpr size_t field_count()
+      {
+         if constexpr (is_constructible_from<T, std::make_index_sequence<N + 1>>::value)
+            return field_count<T, N + 1>();
+         else
+            return N;
+      }
+
+      /* Calls visitor with every field of an aggregate, in declaration order, as the contract toolchain reflects tables */
+      template <typename T, typename Visitor>
+      void for_each_field(T &value, Visitor &&visitor)
+      {
+         constexpr auto count = field_count<std::remove_const_t<T>>();
+         static_assert(count <= 8, "aggregates with more than 8 fields are not reflected");
+         if constexpr (count == 1)
+         {
+            auto &[a] = value;
+            visitor(a);
+         }
+         else if constexpr (count == 2)
+         {
+            auto &[a, b] = value;
+            visitor(a), visitor(b);
+         }
+         else if constexpr (count == 3)
+         {
+            auto &[a, b, c] = value;
+            visitor(a), visitor(b), visitor(c);
+         }
+         else if constexpr (count == 4)
+         {
+            auto &[a, b, c, d] = value;
+            visitor(a), visitor(b), visitor(c), visitor(d);
+         }
+         else if constexpr (count == 5)
+         {
+            auto &[a, b, c, d, e] = value;
+            visitor(a), visitor(b), visitor(c), visitor(d), visitor(e);
+         }
+         else if constexpr (count == 6)
+         {
+            auto &[a, b, c, d, e, f] = value;
+            visitor(a), visitor(b), visitor(c), visitor(d), visitor(e), visitor(f);
+         }
+         else if constexpr (count == 7)
+         {
+            auto &[a, b, c, d, e, f, g] = value;
+            visitor(a), visitor(b), visitor(c), visitor(d), visitor(e), visitor(f), visitor(g);
+         }
+         else if constexpr (count == 8)
+         {
+            auto &[a, b, c, d, e, f, g, h] = value;
+            visitor(a), visitor(b), visitor(c), visitor(d), visitor(e), visitor(f), visitor(g), visitor(h);
+         }
+      }
+
+      template <typename T, template <typename...> class Template>
+      struct is_specialization : std::false_type
+      {
+      };
+
+      template <template <typename...> class Template, typename... Args>
+      struct is_specialization<Template<Args...>, Template> : std::true_type
+      {
+      };
+
+      /* Types which are not aggregates expose their fields through fields() */
+      template <typename T, typename = void>
+      struct has_fields : std::false_type
+      {
+      };
+
+      template <typename T>
+      struct has_fields<T, std::void_t<decltype(std::declval<T &>().fields())>> : std::true_type
+      {
+      };
+
+      template <typename T>
+      constexpr bool is_raw_v = std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_same_v<T, uint128_t> || std::is_same_v<T, __int128>;
+   } // namespace reflection
+
+   template <typename Stream>
+   datastream<Stream> &operator<<(datastream<Stream> &ds, const unsigned_int &v)
+   {
+      uint64_t value = v.value;
+      do
+      {
+         uint8_t byte = value & 0x7F;
+         value >>= 7;
+         byte |= (value > 0) << 7;
+         ds.write(reinterpret_cast<const char *>(&byte), 1);
+      } while (value != 0);
+      return ds;
+   }
+
+   template <typename Stream>
+   datastream<Stream> &operator>>(datastream<Stream> &ds, unsigned_int &v)
+   {
+      uint64_t value = 0;
+      uint8_t byte;
+      uint8_t shift = 0;
+      do
+      {
+         ds.read(reinterpret_cast<char *>(&byte), 1);
+         value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+         shift += 7;
+      } while ((byte & 0x80) && shift < 35);
+      v.value = static_cast<uint32_t>(value);
+      return ds;
+   }
+
+   template <typename Stream, typename T>
+   datastream<Stream> &operator<<(datastream<Stream> &ds, const T &v)
+   {
+      using namespace reflection;
+      if constexpr (std::is_same_v<T, bool>)
+      {
+         const uint8_t byte = v ? 1 : 0;
+         ds.write(reinterpret_cast<const char *>(&byte), 1);
+      }
+      else if constexpr (is_raw_v<T>)
+         ds.write(reinterpret_cast<const char *>(&v), sizeof(v));
+      else if constexpr (std::is_same_v<T, name>)
+         ds << v.value;
+      else if constexpr (is_specialization<T, std::basic_string>::value)
+      {
+         ds << unsigned_int{static_cast<uint32_t>(v.size())};
+         ds.write(v.data(), v.size());
+      }
+      else if constexpr (is_specialization<T, std::vector>::value)
+      {
+         ds << unsigned_int{static_cast<uint32_t>(v.size())};
+         for (const auto &element : v)
+            ds << element;
+      }
+      else if constexpr (is_specialization<T, std::map>::value)
+      {
+         ds << unsigned_int{static_cast<uint32_t>(v.size())};
+         for (const auto &[key, value] : v)
+            ds << key << value;
+      }
+      else if constexpr (is_specialization<T, std::pair>::value)
+         ds << v.first << v.second;
+      else if constexpr (is_specialization<T, std::tuple>::value)
+         std::apply([&ds](const auto &... elements) { ((ds << elements), ...); }, v);
+      else if constexpr (is_specialization<T, std::optional>::value)
+      {
+         ds << v.has_value();
+         if (v)
+            ds << *v;
+      }
+      else if constexpr (has_fields<const T>::value)
+         ds << v.fields();
+      else
+      {
+         static_assert(std::is_aggregate_v<T>, "type can't be packed");
+         for_each_field(v, [&ds](const auto &field) { ds << field; });
+      }
+      return ds;
+   }
+
+   template <typename Stream, typename T>
+   datastream<Stream> &operator>>(datastream<Stream> &ds, T &v)
+   {
+      using namespace reflection;
+      if constexpr (std::is_same_v<T, bool>)
+      {
+         uint8_t byte;
+         ds.read(reinterpret_cast<char *>(&byte), 1);
+         v = byte != 0;
+      }
+      else if constexpr (is_raw_v<T>)
+         ds.read(reinterpret_cast<char *>(&v), sizeof(v));
+      else if constexpr (std::is_same_v<T, name>)
+         ds >> v.value;
+      else if constexpr (is_specialization<T, std::basic_string>::value)
+      {
+         unsigned_int size;
+         ds >> size;
+         v.resize(size.value);
+         ds.read(v.data(), size.value);
+      }
+      else if constexpr (is_specialization<T, std::vector>::value)
+      {
+         unsigned_int size;
+         ds >> size;
+         v.clear();
+         v.resize(size.value);
+         for (auto &element : v)
+            ds >> element;
+      }
+      else if constexpr (is_specialization<T, std::map>::value)
+      {
+         unsigned_int size;
+         ds >> size;
+         v.clear();
+         for (uint32_t i = 0; i < size.value; i++)
+         {
+            typename T::key_type key{};
+            typename T::mapped_type value{};
+            ds >> key >> value;
+            v.emplace(std::move(key), std::move(value));
+         }
+      }
+      else if constexpr (is_specialization<T, std::pair>::value)
+         ds >> v.first >> v.second;
+      else if constexpr (is_specialization<T, std::tuple>::value)
+         std::apply([&ds](auto &... elements) { ((ds >> elements), ...); }, v);
+      else if constexpr (is_specialization<T, std::optional>::value)
+      {
+         bool has_value;
+         ds >> has_value;
+         v.reset();
+         if (has_value)
+         {
+            typename T::value_type value{};
+            ds >> value;
+            v = std::move(value);
+         }
+      }
+      else if constexpr (has_fields<T>::value)
+      {
+         auto fields = v.fields();
+         ds >> fields;
+      }
+      else
+      {
+         static_assert(std::is_aggregate_v<T>, "type can't be unpacked");
+         for_each_field(v, [&ds](auto &field) { ds >> field; });
+      }
+      return ds;
+   }
+
+   template <typename T>
+   size_t pack_size(const T &value)
+   {
+      datastream<size_t> ds;
+      ds << value;
+      return ds.tellp();
+   }
+
+   template <typename T>
+   std::vector<char> pack(const T &value)
+   {
+      std::vector<char> bytes(pack_size(value));
+      datastream<char *> ds{bytes.data(), bytes.size()};
+      ds << value;
+      return bytes;
+   }
+
+   template <typename T>
+   T unpack(const char *data, size_t size)
+   {
+      T value{};
+      datastream<const char *> ds{data, size};
+      ds >> value;
+      return value;
+   }
+} // namespace eosio
@@ -0,0 +1,103 @@
+#pragma once
+#include "action.hpp"
+#include "datastream.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "system.hpp"
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+/*
+   Host emulation of the contract toolchain headers, enough to build medical.cpp natively
+   Contracts run against the intrinsics of chain.cpp instead of nodeos, with the same table and action formats
+*/
+#define ACTION [[eosio::action]] void
+#define TABLE struct [[eosio::table]]
+#define CONTRACT class [[eosio::contract]]
+
+namespace eosio
+{
+   inline void print_value(const char *text)
+   {
+      internal_use_do_not_use::prints_l(text, static_cast<uint32_t>(std::char_traits<char>::length(text)));
+   }
+
+   inline void print_value(std::string_view text)
+   {
+      internal_use_do_not_use::prints_l(text.data(), static_cast<uint32_t>(text.size()));
+   }
+
+   inline void print_value(name n)
+   {
+      print_value(n.to_string());
+   }
+
+   template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+   void print_value(T number)
+   {
+      print_value(std::to_string(number));
+   }
+
+   template <typename... Args>
+   void print(Args &&... args)
+   {
+      (print_value(std::forward<Args>(args)), ...);
+   }
+
+   class contract
+   {
+   public:
+      contract(name self, name first_receiver, datastream<const char *> ds) : _self{self}, _first_receiver{first_receiver}, _ds{ds} {}
+
+      name get_self() const { return _self; }
+      name get_code() const { return _first_receiver; }
+      datastream<const char *> &get_datastream() { return _ds; }
+
+   protected:
+      name _self;
+      name _first_receiver;
+      datastream<const char *> _ds;
+   };
+
+   /* Unpacks arguments of the current action and calls contract member with them */
+   template <typename T, typename... Args>
+   bool execute_action(name self, name code, void (T::*function)(Args...))
+   {
+      const auto size = internal_use_do_not_use::action_data_size();
+      std::vector<char> buffer(size);
+      internal_use_do_not_use::read_action_data(buffer.data(), size);
+      std::tuple<std::decay_t<Args>...> arguments{};
+      datastream<const char *> ds{buffer.data(), buffer.size()};
+      ds >> arguments;
+      T instance{self, code, ds};
+      std::apply([&instance, function](auto &... argument) { (instance.*function)(argument...); }, arguments);
+      return true;
+   }
+} // namespace eosio
+
+#define EOSIO_DISPATCH_CASE(member)                                                                            \
+   case eosio::name(#member).value:                                                                            \
+      eosio::execute_action(eosio::name(receiver), eosio::name(code), &eosio_dispatch_contract::member);       \
+      break;
+#define EOSIO_DISPATCH_SEQ_A(member) EOSIO_DISPATCH_CASE(member) EOSIO_DISPATCH_SEQ_B
+#define EOSIO_DISPATCH_SEQ_B(member) EOSIO_DISPATCH_CASE(member) EOSIO_DISPATCH_SEQ_A
+#define EOSIO_DISPATCH_SEQ_A_END
+#define EOSIO_DISPATCH_SEQ_B_END
+#define EOSIO_DISPATCH_CAT(a, b) EOSIO_DISPATCH_CAT_I(a, b)
+#define EOSIO_DISPATCH_CAT_I(a, b) a##b
+
+/* Entry point the chain calls for every action sent to an account running the contract */
+#define EOSIO_DISPATCH(TYPE, MEMBERS)                                                                          \
+   extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action)                                    \
+   {                                                                                                           \
+      using eosio_dispatch_contract = TYPE;                                                                    \
+      if (code == receiver)                                                                                    \
+      {                                                                                                        \
+         switch (action)                                                                                       \
+         {                                                                                                     \
+            EOSIO_DISPATCH_CAT(EOSIO_DISPATCH_SEQ_A MEMBERS, _END)                                             \
+         }                                                                                                     \
+      }                                                                                                        \
+   }
@@ -0,0 +1,238 @@
+#pragma once
+#include "datastream.hpp"
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace eosio
+{
+   static const name same_payer{};
+
+   /*
+      Table of rows of type T keyed by primary key, stored by the chain in the packed format of nodeos
+      Loaded rows are cached by the table object, so references to them stay valid until the row is erased;
+      only primary index is provided, contract uses no secondary ones
+   */
+   template <name::raw TableName, typename T, typename... Indices>
+   class multi_index
+   {
+   private:
+      struct item
+      {
+         T value;
+         int32_t iterator;
+      };
+
+   public:
+      class const_iterator
+      {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = const T;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const T *;
+         using reference = const T &;
+
+         const T &operator*() const
+         {
+            eosio_assert(m_item != nullptr, "cannot dereference end iterator");
+            return m_item->value;
+         }
+         const T *operator->() const { return &**this; }
+
+         const_iterator &operator++()
+         {
+            eosio_assert(m_item != nullptr, "cannot increment end iterator");
+            uint64_t primary = 0;
+            const auto next = db_next_i64(m_item->iterator, &primary);
+            m_item = next < 0 ? nullptr : m_table->load(next);
+            return *this;
+         }
+
+         const_iterator &operator--()
+         {
+            uint64_t primary = 0;
+            if (m_item == nullptr)
+            {
+               const auto end = db_end_i64(m_table->m_code.value, m_table->m_scope, static_cast<uint64_t>(TableName));
+               eosio_assert(end != -1, "cannot decrement end iterator when the table is empty");
+               const auto previous = db_previous_i64(end, &primary);
+               eosio_assert(previous >= 0, "cannot decrement end iterator when the table is empty");
+               m_item = m_table->load(previous);
+            }
+            else
+            {
+               const auto previous = db_previous_i64(m_item->iterator, &primary);
+               eosio_assert(previous >= 0, "cannot decrement iterator at beginning of table");
+               m_item = m_table->load(previous);
+            }
+            return *this;
+         }
+
+         const_iterator operator++(int)
+         {
+            auto copy = *this;
+            ++*this;
+            return copy;
+         }
+
+         const_iterator operator--(int)
+         {
+            auto copy = *this;
+            --*this;
+            return copy;
+         }
+
+         friend bool operator==(const const_iterator &a, const const_iterator &b) { return a.m_item == b.m_item; }
+         friend bool operator!=(const const_iterator &a, const const_iterator &b) { return a.m_item != b.m_item; }
+
+      private:
+         friend class multi_index;
+
+         const_iterator(const multi_index *table, const item *item) : m_table{table}, m_item{item} {}
+
+         const multi_index *m_table;
+         const item *m_item;
+      };
+
+      multi_index(name code, uint64_t scope) : m_code{code}, m_scope{scope} {}
+      multi_index(const multi_index &) = delete;
+      multi_index &operator=(const multi_index &) = delete;
+
+      name get_code() const { return m_code; }
+      uint64_t get_scope() const { return m_scope; }
+
+      const_iterator begin() const { return lower_bound(0); }
+      const_iterator end() const { return {this, nullptr}; }
+
+      const_iterator find(uint64_t primary) const
+      {
+         for (const auto &cached : m_items)
+         {
+            if (cached->value.primary_key() == primary)
+               return {this, cached.get()};
+         }
+         const auto iterator = db_find_i64(m_code.value, m_scope, static_cast<uint64_t>(TableName), primary);
+         return {this, iterator < 0 ? nullptr : load(iterator)};
+      }
+
+      const T &get(uint64_t primary, const char *error_msg = "unable to find key") const
+      {
+         const auto result = find(primary);
+         eosio_assert(result != end(), error_msg);
+         return *result;
+      }
+
+      const_iterator lower_bound(uint64_t primary) const
+      {
+         const auto iterator = db_lowerbound_i64(m_code.value, m_scope, static_cast<uint64_t>(TableName), primary);
+         return {this, iterator < 0 ? nullptr : load(iterator)};
+      }
+
+      const_iterator upper_bound(uint64_t primary) const
+      {
+         const auto iterator = db_upperbound_i64(m_code.value, m_scope, static_cast<uint64_t>(TableName), primary);
+         return {this, iterator < 0 ? nullptr : load(iterator)};
+      }
+
+      uint64_t available_primary_key() const
+      {
+         const auto end = db_end_i64(m_code.value, m_scope, static_cast<uint64_t>(TableName));
+         if (end == -1)
+            return 0;
+         uint64_t primary = 0;
+         return db_previous_i64(end, &primary) < 0 ? 0 : primary + 1;
+      }
+
+      template <typename Lambda>
+      const_iterator emplace(name payer, Lambda &&constructor)
+      {
+         eosio_assert(m_code.value == internal_use_do_not_use::current_receiver(), "cannot create objects in table of another contract");
+         auto created = std::make_unique<item>();
+         constructor(created->value);
+         const auto bytes = pack(created->value);
+         created->iterator = db_store_i64(m_scope, static_cast<uint64_t>(TableName), payer.value, created->value.primary_key(), bytes.data(),
+                                          static_cast<uint32_t>(bytes.size()));
+         m_items.push_back(std::move(created));
+         return {this, m_items.back().get()};
+      }
+
+      template <typename Lambda>
+      void modify(const_iterator position, name payer, Lambda &&updater)
+      {
+         eosio_assert(position != end(), "cannot pass end iterator to modify");
+         modify(*position, payer, std::forward<Lambda>(updater));
+      }
+
+      template <typename Lambda>
+      void modify(const T &object, name payer, Lambda &&updater)
+      {
+         eosio_assert(m_code.value == internal_use_do_not_use::current_receiver(), "cannot modify objects in table of another contract");
+         auto &modified = const_cast<item &>(owner(object));
+         const auto primary = modified.value.primary_key();
+         updater(modified.value);
+         eosio_assert(primary == modified.value.primary_key(), "updater cannot change primary key when modifying an object");
+         const auto bytes = pack(modified.value);
+         db_update_i64(modified.iterator, payer.value, bytes.data(), static_cast<uint32_t>(bytes.size()));
+      }
+
+      const_iterator erase(const_iterator position)
+      {
+         eosio_assert(position != end(), "cannot pass end iterator to erase");
+         auto next = position;
+         ++next;
+         erase(*position);
+         return next;
+      }
+
+      void erase(const T &object)
+      {
+         eosio_assert(m_code.value == internal_use_do_not_use::current_receiver(), "cannot erase objects in table of another contract");
+         const auto &erased = owner(object);
+         db_remove_i64(erased.iterator);
+         for (auto cached = m_items.begin(); cached != m_items.end(); ++cached)
+         {
+            if (cached->get() == &erased)
+            {
+               m_items.erase(cached);
+               break;
+            }
+         }
+      }
+
+   private:
+      /* Row at chain iterator, from cache if it was loaded before */
+      const item *load(int32_t iterator) const
+      {
+         for (const auto &cached : m_items)
+         {
+            if (cached->iterator == iterator)
+               return cached.get();
+         }
+         const auto size = db_get_i64(iterator, nullptr, 0);
+         std::vector<char> bytes(static_cast<size_t>(size));
+         db_get_i64(iterator, bytes.data(), static_cast<uint32_t>(size));
+         auto loaded = std::make_unique<item>();
+         datastream<const char *> ds{bytes.data(), bytes.size()};
+         ds >> loaded->value;
+         loaded->iterator = iterator;
+         m_items.push_back(std::move(loaded));
+         return m_items.back().get();
+      }
+
+      const item &owner(const T &object) const
+      {
+         for (const auto &cached : m_items)
+         {
+            if (&cached->value == &object)
+               return *cached;
+         }
+         eosio_assert(false, "object passed to modify or erase is not in multi_index");
+         return *m_items.front();
+      }
+
+      name m_code;
+      uint64_t m_scope;
+      mutable std::vector<std::unique_ptr<item>> m_items;
+   };
+} // namespace eosio
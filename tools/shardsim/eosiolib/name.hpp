@@ -0,0 +1,74 @@
+#pragma once
+#include "system.hpp"
+#include <string>
+#include <string_view>
+
+namespace eosio
+{
+   /* Account and action names, base32 encoded into 64 bits as nodeos does */
+   struct name
+   {
+      enum class raw : uint64_t
+      {
+      };
+
+      constexpr name() : value{0} {}
+      constexpr explicit name(uint64_t v) : value{v} {}
+      constexpr explicit name(name::raw r) : value{static_cast<uint64_t>(r)} {}
+      constexpr explicit name(std::string_view str) : value{0}
+      {
+         if (str.size() > 13)
+            eosio_assert(false, "string is too long to be a valid name");
+         const auto n = str.size() < 12 ? str.size() : 12;
+         for (size_t i = 0; i < n; i++)
+         {
+            value <<= 5;
+            value |= char_to_value(str[i]);
+         }
+         value <<= 4 + 5 * (12 - n);
+         if (str.size() == 13)
+         {
+            const uint64_t v = char_to_value(str[12]);
+            if (v > 0x0F)
+               eosio_assert(false, "thirteenth character in name cannot be a letter that comes after j");
+            value |= v;
+         }
+      }
+
+      static constexpr uint8_t char_to_value(char c)
+      {
+         if (c == '.')
+            return 0;
+         if (c >= '1' && c <= '5')
+            return static_cast<uint8_t>(c - '1') + 1;
+         if (c >= 'a' && c <= 'z')
+            return static_cast<uint8_t>(c - 'a') + 6;
+         eosio_assert(false, "character is not in allowed character set for names");
+         return 0;
+      }
+
+      constexpr operator raw() const { return raw(value); }
+      constexpr explicit operator bool() const { return value != 0; }
+
+      std::string to_string() const
+      {
+         static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+         std::string str(13, '.');
+         auto tmp = value;
+         for (auto i = 0; i <= 12; i++)
+         {
+            str[12 - i] = charmap[tmp & (i == 0 ? 0x0F : 0x1F)];
+            tmp >>= (i == 0 ? 4 : 5);
+         }
+         const auto last = str.find_last_not_of('.');
+         str.resize(last == std::string::npos ? 0 : last + 1);
+         return str;
+      }
+
+      friend constexpr bool operator==(const name &a, const name &b) { return a.value == b.value; }
+      friend constexpr bool operator!=(const name &a, const name &b) { return a.value != b.value; }
+      friend constexpr bool operator<(const name &a, const name &b) { return a.value < b.value; }
+
+      uint64_t value;
+   };
+} // namespace eosio
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+   Intrinsics of the host chain, the same calls contracts make to nodeos
+   Implemented by chain.cpp; failed assertions throw, so that the chain reverts the transaction
+*/
+typedef unsigned __int128 uint128_t;
+
+extern "C"
+{
+   void eosio_assert(uint32_t test, const char *msg);
+
+   uint64_t current_time();
+
+   int cancel_deferred(const uint128_t &sender_id);
+   void send_deferred(const uint128_t &sender_id, uint64_t payer, const char *serialized_transaction, size_t size, uint32_t replace_existing);
+
+   int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void *data, uint32_t len);
+   void db_update_i64(int32_t iterator, uint64_t payer, const void *data, uint32_t len);
+   void db_remove_i64(int32_t iterator);
+   int32_t db_get_i64(int32_t iterator, void *data, uint32_t len);
+   int32_t db_next_i64(int32_t iterator, uint64_t *primary);
+   int32_t db_previous_i64(int32_t iterator, uint64_t *primary);
+   int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+   int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+   int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+   int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table);
+}
+
+inline uint32_t now()
+{
+   return static_cast<uint32_t>(current_time() / 1000000);
+}
+
+namespace eosio
+{
+   namespace internal_use_do_not_use
+   {
+      extern "C"
+      {
+         uint32_t read_action_data(void *msg, uint32_t len);
+         uint32_t action_data_size();
+         uint64_t current_receiver();
+         void require_auth(uint64_t name);
+         bool has_auth(uint64_t name);
+         bool is_account(uint64_t name);
+         void send_inline(const char *serialized_action, size_t size);
+         void prints_l(const char *text, uint32_t len);
+      }
+   } // namespace internal_use_do_not_use
+} // namespace eosio
@@ -0,0 +1,18 @@
+#pragma once
+#include "action.hpp"
+
+namespace eosio
+{
+   /* Deferred transaction, executed by the chain once its delay elapses */
+   struct transaction
+   {
+      uint32_t delay_sec = 0;
+      std::vector<action> actions;
+
+      void send(const uint128_t &sender_id, name payer, bool replace_existing = false) const
+      {
+         const auto bytes = pack(*this);
+         send_deferred(sender_id, payer.value, bytes.data(), bytes.size(), replace_existing);
+      }
+   };
+} // namespace eosio
@@ -0,0 +1,238 @@
+#include "chain.hpp"
+#include "medical.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action);
+
+/*
+   Sharded deployment of the medical contract, run in process
+   Every shard is a separate account running medical.cpp on the host chain; the scenario registers doctors and groups
+   before and after shards are set, mirrors the early ones, routes patients and reads across shards, and checks that
+   doctor and group rows stay identical on every shard. Exits with 1 if any check fails
+*/
+namespace
+{
+   const eosio::name SHARDS[] = {eosio::name{"medshard1"}, eosio::name{"medshard2"}, eosio::name{"medshard3"}};
+   const eosio::name INSTITUTION{"hospital"};
+   const eosio::name GROUP{"wardone"};
+   /* Registered before shards are set and mirrored afterwards */
+   const eosio::name EARLY_DOCTOR{"drhouse"};
+   /* Registered before shards are set and never mirrored */
+   const eosio::name LOCAL_DOCTOR{"drcuddy"};
+   /* Registered after shards are set */
+   const eosio::name LATE_DOCTOR{"drwilson"};
+   const uint8_t SPECIALTY = 3;
+   /* DER encoded RSA-2048 public key and ciphertext of RSA-2048 */
+   const size_t PUBLIC_KEY_SIZE = 294;
+   const size_t CIPHERTEXT_SIZE = 256;
+
+   unsigned checks = 0;
+   unsigned failures = 0;
+
+   void expect(bool condition, const std::string &what)
+   {
+      checks++;
+      if (!condition)
+      {
+         failures++;
+         std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+      }
+   }
+
+   void expect_applied(const shardsim::receipt &receipt, const std::string &what)
+   {
+      expect(receipt.applied, what + (receipt.applied ? "" : ": " + receipt.error));
+   }
+
+   void expect_error(const shardsim::receipt &receipt, const std::string &error, const std::string &what)
+   {
+      expect(!receipt.applied && receipt.error == error, what + ": " + (receipt.applied ? std::string{"applied"} : receipt.error));
+   }
+
+   bool printed(const shardsim::receipt &receipt, const std::string &text)
+   {
+      return receipt.applied && !receipt.console.empty() && receipt.console.front().find(text) != std::string::npos;
+   }
+
+   /* Key of size bytes in the base64 text actions take */
+   std::string key_text(size_t size, uint8_t seed)
+   {
+      std::vector<uint8_t> key(size + 1);
+      key[0] = keys::BINARY_FORMAT;
+      for (size_t i = 1; i <= size; i++)
+         key[i] = static_cast<uint8_t>(seed + i * 31);
+      return keys::encode_text(key);
+   }
+
+   eosio::name shard_of(eosio::name patient)
+   {
+      return SHARDS[sharding::shard_of(patient.value, std::size(SHARDS))];
+   }
+
+   /* Some other shard than the one patient belongs to */
+   eosio::name foreign_shard(eosio::name patient)
+   {
+      return shard_of(patient) == SHARDS[0] ? SHARDS[1] : SHARDS[0];
+   }
+
+   bool has_doctor(eosio::name shard, eosio::name doctor)
+   {
+      medical::doctors _doctors{shard, doctor.value};
+      return _doctors.find(doctor.value) != _doctors.end();
+   }
+
+   bool has_membership(eosio::name shard, eosio::name doctor)
+   {
+      medical::memberships _memberships{shard, doctor.value};
+      return _memberships.find(GROUP.value) != _memberships.end();
+   }
+
+   /* Members of the group on shard, in order, or nothing if group is missing */
+   std::vector<eosio::name> members(eosio::name shard)
+   {
+      medical::groups _groups{shard, shard.value};
+      const auto group_iter = _groups.find(GROUP.value);
+      return group_iter == _groups.end() ? std::vector<eosio::name>{} : group_iter->members;
+   }
+
+   void expect_everywhere(bool (*check)(eosio::name, eosio::name), eosio::name account, bool expected, const std::string &what)
+   {
+      for (const auto shard : SHARDS)
+         expect(check(shard, account) == expected, what + " on " + shard.to_string());
+   }
+
+   void expect_members(const std::vector<eosio::name> &expected, const std::string &what)
+   {
+      for (const auto shard : SHARDS)
+         expect(members(shard) == expected, what + " on " + shard.to_string());
+   }
+
+   /* First patient name of every shard, from patient1, patient2, ... */
+   std::vector<eosio::name> patient_per_shard()
+   {
+      std::vector<eosio::name> patients(std::size(SHARDS));
+      const std::string suffixes = "12345abcdefghijklmnopqrstuvwxyz";
+      for (const auto suffix : suffixes)
+      {
+         const eosio::name patient{std::string{"patient"} + suffix};
+         const auto shard = sharding::shard_of(patient.value, std::size(SHARDS));
+         if (!patients[shard])
+            patients[shard] = patient;
+      }
+      for (const auto patient : patients)
+         expect(static_cast<bool>(patient), "every shard is assigned some patient");
+      return patients;
+   }
+} // namespace
+
+int main()
+{
+   for (const auto shard : SHARDS)
+      shardsim::create_account(shard, apply);
+   for (const auto account : {INSTITUTION, EARLY_DOCTOR, LOCAL_DOCTOR, LATE_DOCTOR})
+      shardsim::create_account(account);
+   const auto patients = patient_per_shard();
+   for (const auto patient : patients)
+      shardsim::create_account(patient);
+
+   for (const auto shard : SHARDS)
+   {
+      expect_applied(shardsim::push(shard, shard, eosio::name{"loadrights"}), "load rights");
+      expect_applied(shardsim::push(shard, shard, eosio::name{"begloaddspcs"}), "load specialties");
+      expect_applied(shardsim::push(shard, shard, eosio::name{"fnshloadspcs"}), "finish specialties");
+   }
+
+   /* Single contract deployment, which later becomes the first shard */
+   const auto first = SHARDS[0];
+   expect_applied(shardsim::push(first, first, eosio::name{"upsertdoc"}, EARLY_DOCTOR, SPECIALTY, key_text(PUBLIC_KEY_SIZE, 1)),
+                  "register doctor before sharding");
+   expect_applied(shardsim::push(first, first, eosio::name{"upsertdoc"}, LOCAL_DOCTOR, SPECIALTY, key_text(PUBLIC_KEY_SIZE, 2)),
+                  "register local doctor before sharding");
+   expect_applied(shardsim::push(first, first, eosio::name{"upsertgroup"}, GROUP, INSTITUTION, key_text(PUBLIC_KEY_SIZE, 3)),
+                  "register group before sharding");
+   expect_applied(shardsim::push(INSTITUTION, first, eosio::name{"addmember"}, GROUP, EARLY_DOCTOR), "add member before sharding");
+
+   const std::vector<eosio::name> shard_list{std::begin(SHARDS), std::end(SHARDS)};
+   for (const auto shard : SHARDS)
+      expect_applied(shardsim::push(shard, shard, eosio::name{"setshards"}, shard_list), "set shards");
+
+   /* Patients are registered only on their own shard */
+   for (const auto patient : patients)
+   {
+      expect_error(shardsim::push(foreign_shard(patient), foreign_shard(patient), eosio::name{"upsertpat"}, patient,
+                                  key_text(PUBLIC_KEY_SIZE, 4)),
+                   "this patient belongs to another shard", "register patient on foreign shard");
+      expect_applied(shardsim::push(shard_of(patient), shard_of(patient), eosio::name{"upsertpat"}, patient, key_text(PUBLIC_KEY_SIZE, 4)),
+                     "register patient on own shard");
+   }
+
+   /* Patient rows can't move, so shards list can't change in a way which assigns them to another shard */
+   const std::vector<eosio::name> reordered{shard_list.rbegin(), shard_list.rend()};
+   expect_error(shardsim::push(first, first, eosio::name{"setshards"}, reordered), "registered patients would be assigned to another shard",
+                "reorder shards with registered patients");
+   expect_applied(shardsim::push(first, first, eosio::name{"setshards"}, shard_list), "set the same shards again");
+
+   /* Doctors registered after shards were set are forwarded to every shard */
+   expect_applied(shardsim::push(SHARDS[1], SHARDS[1], eosio::name{"upsertdoc"}, LATE_DOCTOR, SPECIALTY, key_text(PUBLIC_KEY_SIZE, 5)),
+                  "register doctor after sharding");
+   expect_everywhere(has_doctor, LATE_DOCTOR, true, "doctor registered after sharding is mirrored");
+   expect_error(shardsim::push(SHARDS[1], SHARDS[1], eosio::name{"upsertdoc"}, LATE_DOCTOR, SPECIALTY, key_text(keys::MAX_KEY_SIZE + 1, 5)),
+                "public key must be base64 of a DER encoded key of at most 2048 bytes", "key longer than bound is refused");
+
+   /* Doctors and groups registered before exist only on the first shard until mirrored */
+   expect(!has_doctor(SHARDS[1], EARLY_DOCTOR) && members(SHARDS[1]).empty(), "early registrations are not mirrored yet");
+   expect_error(shardsim::push(INSTITUTION, first, eosio::name{"addmember"}, GROUP, LATE_DOCTOR), "this group wasn't registered before",
+                "forwarded membership of group which was not mirrored");
+   const auto mirrored = shardsim::push(first, first, eosio::name{"mirror"}, std::vector<eosio::name>{GROUP, EARLY_DOCTOR});
+   expect(printed(mirrored, "\"skipped\":[]"), "mirror early registrations");
+   expect_everywhere(has_doctor, EARLY_DOCTOR, true, "early doctor is mirrored");
+   expect_everywhere(has_membership, EARLY_DOCTOR, true, "early membership is mirrored");
+   expect_members({EARLY_DOCTOR}, "early group is mirrored");
+   expect_applied(shardsim::push(first, first, eosio::name{"mirror"}, std::vector<eosio::name>{GROUP, EARLY_DOCTOR}), "mirror again");
+   expect_members({EARLY_DOCTOR}, "mirroring again changes nothing");
+   expect(has_doctor(first, LOCAL_DOCTOR) && !has_doctor(SHARDS[1], LOCAL_DOCTOR), "doctor which is not mirrored stays on first shard");
+
+   /* Memberships are forwarded once group is mirrored */
+   expect_applied(shardsim::push(INSTITUTION, SHARDS[2], eosio::name{"addmember"}, GROUP, LATE_DOCTOR), "add member after mirroring");
+   expect_members({EARLY_DOCTOR, LATE_DOCTOR}, "membership is forwarded");
+
+   /* Patient of another shard than the first one grants the mirrored group and reads through it */
+   const auto patient = patients[1];
+   const auto home = shard_of(patient);
+   const medical::perm_info group_perm{patient, GROUP};
+   const medical::interval infinite{0, 0};
+   expect_applied(shardsim::push(patient, home, eosio::name{"addperm"}, group_perm, std::vector<uint8_t>{SPECIALTY}, static_cast<uint8_t>(medical::right::READ),
+                                 infinite, key_text(CIPHERTEXT_SIZE, 6)),
+                  "grant mirrored group");
+   const medical::record_info record{"hash1", "checkup"};
+   expect_applied(shardsim::push(home, home, eosio::name{"writerecord"}, medical::perm_info{patient, home}, SPECIALTY, record), "write record");
+
+   const medical::interval interval{1, now() + 3600};
+   const medical::perm_info read_perm{patient, EARLY_DOCTOR};
+   const auto read = shardsim::push(EARLY_DOCTOR, home, eosio::name{"readrecords"}, read_perm, std::vector<uint8_t>{SPECIALTY}, interval, uint64_t{0});
+   expect_applied(read, "member of mirrored group reads");
+   expect(printed(read, "\"hash\":\"hash1\"") && !printed(read, "\"version\""), "records are answered specialty keyed");
+   const auto versioned = shardsim::push(EARLY_DOCTOR, home, eosio::name{"readrecords"}, read_perm, std::vector<uint8_t>{SPECIALTY}, interval,
+                                         medical::chartversion::NO_COPY);
+   expect(printed(versioned, "\"records\":{") && printed(versioned, "\"version\":"), "versioned answer wraps records");
+
+   /* Reads sent to a wrong shard name the shard which owns the patient */
+   expect_error(shardsim::push(EARLY_DOCTOR, foreign_shard(patient), eosio::name{"readrecords"}, read_perm, std::vector<uint8_t>{SPECIALTY}, interval,
+                               uint64_t{0}),
+                "this patient belongs to another shard", "read on foreign shard");
+   const std::vector<medical::read_request> requests{{patient, {SPECIALTY}, interval, 0}};
+   const auto batch = shardsim::push(EARLY_DOCTOR, foreign_shard(patient), eosio::name{"readbatch"}, EARLY_DOCTOR, requests);
+   expect(printed(batch, "\"shard\":\"" + home.to_string() + "\""), "batch names shard of foreign patient");
+
+   /* Removals are forwarded, shards which never had the row have nothing to remove */
+   expect_applied(shardsim::push(first, first, eosio::name{"rmdoctor"}, EARLY_DOCTOR), "remove mirrored doctor");
+   expect_everywhere(has_doctor, EARLY_DOCTOR, false, "doctor is removed from every shard");
+   expect_members({LATE_DOCTOR}, "removed doctor leaves group on every shard");
+   expect_applied(shardsim::push(first, first, eosio::name{"rmdoctor"}, LOCAL_DOCTOR), "remove doctor which was never mirrored");
+   expect_everywhere(has_doctor, LOCAL_DOCTOR, false, "unmirrored doctor is removed");
+
+   std::printf("shardsim: %u checks, %u failed\n", checks, failures);
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "name.hpp"
+#include "snapshot.hpp"
+#include "tables.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+   void usage()
+   {
+      std::fprintf(stderr,
+                   "usage: snapshot export -o <file> [--patients <patients.json>] [--doctors <doctors.json>]\n"
+                   "                       [--permissions <dir of <patient>.json>]\n"
+                   "                       [--records <records.bin> --tombstones <dir of <patient>.json>]\n"
+                   "       snapshot info <file>\n"
+                   "       snapshot records <file> <patient> [specialtyid]\n");
+   }
+
+   int export_snapshot(int argc, char **argv)
+   {
+      snapshot::snapshot_writer writer;
+      std::string output, records, tombstones, error;
+      for (auto i = 2; i + 1 < argc; i += 2)
+      {
+         const std::string option = argv[i], value = argv[i + 1];
+         auto loaded = true;
+         if (option == "-o")
+            output = value;
+         else if (option == "--patients")
+            loaded = load_patients_json(value, writer, error);
+         else if (option == "--doctors")
+            loaded = load_doctors_json(value, writer, error);
+         else if (option == "--records")
+            records = value;
+         else if (option == "--tombstones")
+            tombstones = value;
+         else if (option == "--permissions")
+         {
+            /* Permissions table is scoped by patient, cleos dumps one scope per file */
+            std::error_code code;
+            for (const auto &file : std::filesystem::directory_iterator{value, code})
+               if (loaded && file.path().extension() == ".json")
+                  loaded = load_permissions_json(file.path().string(), account_name::from_string(file.path().stem().string()), writer, error);
+            if (code)
+               loaded = false, error = "can't list " + value + ": " + code.message();
+         }
+         else
+         {
+            usage();
+            return 2;
+         }
+         if (!loaded)
+         {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+         }
+      }
+      /* Records dump still holds removed records until compaction, it can't be exported without their tombstones */
+      if (output.empty() || records.empty() != tombstones.empty())
+      {
+         usage();
+         return 2;
+      }
+      removed_records removed;
+      if (!records.empty() && (!removed.load(tombstones, error) || !load_records_dump(records, removed, writer, error)))
+      {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         return 1;
+      }
+      if (!writer.write(output, error))
+      {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         return 1;
+      }
+      return 0;
+   }
+
+   int print_info(const std::string &path)
+   {
+      snapshot::mapped_snapshot snap;
+      std::string error;
+      const auto started = std::chrono::steady_clock::now();
+      if (!snap.open(path, error))
+      {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         return 1;
+      }
+      const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+      std::printf("patients=%zu doctors=%zu permissions=%zu records=%zu spans=%zu load=%.1fus\n", snap.patients().size(), snap.doctors().size(),
+                  snap.permissions().size(), snap.records().size(), snap.record_spans().size(), elapsed);
+      return 0;
+   }
+
+   int print_records(int argc, char **argv)
+   {
+      snapshot::mapped_snapshot snap;
+      std::string error;
+      if (!snap.open(argv[2], error))
+      {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         return 1;
+      }
+      const auto patient = account_name::from_string(argv[3]);
+      const auto records = argc > 4 ? snap.records(patient, static_cast<uint8_t>(std::stoul(argv[4]))) : snap.records(patient);
+      for (const auto &record : records)
+      {
+         const auto hash = snap.string(record.hash);
+         const auto description = snap.string(record.description);
+         std::printf("%u %u %s %.*s %.*s\n", unsigned(record.specialtyid), record.timestamp, account_name::to_string(record.doctor).c_str(),
+                     int(hash.size()), hash.data(), int(description.size()), description.data());
+      }
+      return 0;
+   }
+} // namespace
+
+int main(int argc, char **argv)
+{
+   const std::string command = argc > 1 ? argv[1] : "";
+   if (command == "export")
+      return export_snapshot(argc, argv);
+   if (command == "info" && argc == 3)
+      return print_info(argv[2]);
+   if (command == "records" && (argc == 4 || argc == 5))
+      return print_records(argc, argv);
+   usage();
+   return 2;
+}
@@ -0,0 +1,319 @@
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace snapshot
+{
+   namespace
+   {
+      constexpr size_t SECTION_ALIGNMENT = 8;
+
+      constexpr uint32_t ELEMENT_SIZES[SECTIONS_COUNT] = {
+          sizeof(char),
+          sizeof(patient_entry),
+          sizeof(grant_entry),
+          sizeof(uint64_t),
+          sizeof(permission_entry),
+          sizeof(doctor_entry),
+          sizeof(doctor_key_entry),
+          sizeof(record_entry),
+          sizeof(record_span)};
+
+      constexpr uint64_t align(const uint64_t offset) noexcept
+      {
+         return (offset + SECTION_ALIGNMENT - 1) & ~uint64_t(SECTION_ALIGNMENT - 1);
+      }
+
+      template <typename T, typename Key>
+      const T *find_by_account(const array_view<T> &entries, const Key account) noexcept
+      {
+         const auto iter = std::lower_bound(entries.begin(), entries.end(), account,
+                                            [](const T &entry, const Key key) { return entry.account < key; });
+         return iter != entries.end() && iter->account == account ? iter : nullptr;
+      }
+   } // namespace
+
+   mapped_snapshot::~mapped_snapshot()
+   {
+      if (m_data != nullptr)
+         ::munmap(const_cast<char *>(m_data), m_size);
+   }
+
+   bool mapped_snapshot::open(const std::string &path, std::string &error)
+   {
+      const auto fd = ::open(path.c_str(), O_RDONLY);
+      struct stat info;
+      if (fd < 0 || ::fstat(fd, &info) != 0)
+      {
+         error = "can't open " + path + ": " + std::strerror(errno);
+         if (fd >= 0)
+            ::close(fd);
+         return false;
+      }
+      const auto size = static_cast<size_t>(info.st_size);
+      if (size < sizeof(header))
+      {
+         ::close(fd);
+         error = path + ": not a snapshot";
+         return false;
+      }
+      const auto mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (mapping == MAP_FAILED)
+      {
+         error = "can't map " + path + ": " + std::strerror(errno);
+         return false;
+      }
+      m_data = static_cast<const char *>(mapping);
+      m_size = size;
+
+      /* Validate header and bounds of sections, entries themselves are trusted */
+      const auto candidate = reinterpret_cast<const header *>(m_data);
+      if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0)
+         error = path + ": not a snapshot";
+      else if (candidate->version != FORMAT_VERSION)
+         error = path + ": unsupported snapshot version " + std::to_string(candidate->version);
+      else if (candidate->sections_count != SECTIONS_COUNT || candidate->file_size != size)
+         error = path + ": truncated or corrupted snapshot";
+      for (uint32_t kind = 0; error.empty() && kind < SECTIONS_COUNT; kind++)
+      {
+         const auto &entry = candidate->sections[kind];
+         if (entry.kind != kind || entry.element_size != ELEMENT_SIZES[kind] || entry.offset % SECTION_ALIGNMENT != 0 ||
+             entry.offset > size || entry.count > (size - entry.offset) / entry.element_size)
+            error = path + ": corrupted section " + std::to_string(kind);
+      }
+      if (!error.empty())
+      {
+         ::munmap(mapping, size);
+         m_data = nullptr;
+         m_size = 0;
+         return false;
+      }
+      m_header = candidate;
+      return true;
+   }
+
+   std::string_view mapped_snapshot::string(const string_ref &ref) const noexcept
+   {
+      const auto pool = section<char>(STRINGS).slice(ref.offset, ref.length);
+      return {pool.begin(), pool.size()};
+   }
+
+   const patient_entry *mapped_snapshot::find_patient(const uint64_t account) const noexcept
+   {
+      return find_by_account(patients(), account);
+   }
+
+   const doctor_entry *mapped_snapshot::find_doctor(const uint64_t account) const noexcept
+   {
+      return find_by_account(doctors(), account);
+   }
+
+   array_view<grant_entry> mapped_snapshot::grants(const patient_entry &patient) const noexcept
+   {
+      return section<grant_entry>(GRANTS).slice(patient.first_grant, patient.grants_count);
+   }
+
+   array_view<uint64_t> mapped_snapshot::permission_ids(const grant_entry &grant) const noexcept
+   {
+      return section<uint64_t>(PERMISSION_IDS).slice(grant.first_permission_id, grant.permission_ids_count);
+   }
+
+   array_view<permission_entry> mapped_snapshot::permissions(const uint64_t patient) const noexcept
+   {
+      const auto all = permissions();
+      const auto first = std::lower_bound(all.begin(), all.end(), patient,
+                                          [](const permission_entry &entry, const uint64_t key) { return entry.patient < key; });
+      const auto last = std::upper_bound(first, all.end(), patient,
+                                         [](const uint64_t key, const permission_entry &entry) { return key < entry.patient; });
+      return all.slice(first - all.begin(), last - first);
+   }
+
+   array_view<doctor_key_entry> mapped_snapshot::keys(const doctor_entry &doctor) const noexcept
+   {
+      return section<doctor_key_entry>(DOCTOR_KEYS).slice(doctor.first_key, doctor.keys_count);
+   }
+
+   array_view<record_entry> mapped_snapshot::records(const uint64_t patient) const noexcept
+   {
+      const auto spans = record_spans();
+      const auto first = std::lower_bound(spans.begin(), spans.end(), patient,
+                                          [](const record_span &span, const uint64_t key) { return span.patient < key; });
+      if (first == spans.end() || first->patient != patient)
+         return {};
+      auto last = first;
+      uint64_t count = 0;
+      for (; last != spans.end() && last->patient == patient; ++last)
+         count += last->records_count;
+      return records().slice(first->first_record, count);
+   }
+
+   array_view<record_entry> mapped_snapshot::records(const uint64_t patient, const uint8_t specialtyid) const noexcept
+   {
+      const auto spans = record_spans();
+      const auto span = std::lower_bound(spans.begin(), spans.end(), std::make_pair(patient, specialtyid),
+                                         [](const record_span &span, const std::pair<uint64_t, uint8_t> &key) {
+                                            return span.patient < key.first || (span.patient == key.first && span.specialtyid < key.second);
+                                         });
+      if (span == spans.end() || span->patient != patient || span->specialtyid != specialtyid)
+         return {};
+      return records().slice(span->first_record, span->records_count);
+   }
+
+   snapshot_writer::snapshot_writer()
+   {
+      /* Empty string is shared by all empty fields */
+      m_interned.emplace(std::string{}, string_ref{0, 0});
+   }
+
+   string_ref snapshot_writer::intern(const std::string &text)
+   {
+      /* Keys and descriptions repeat a lot across records, so strings are stored once */
+      const auto [iter, inserted] = m_interned.emplace(text, string_ref{static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(text.size())});
+      if (inserted)
+         m_strings += text;
+      return iter->second;
+   }
+
+   void snapshot_writer::add_patient(const uint64_t account, const std::string &pubenckey,
+                                     const std::vector<std::pair<uint64_t, std::vector<uint64_t>>> &perms)
+   {
+      patient_entry entry{};
+      entry.account = account;
+      entry.pubenckey = intern(pubenckey);
+      entry.first_grant = static_cast<uint32_t>(m_grants.size());
+      entry.grants_count = static_cast<uint32_t>(perms.size());
+      for (const auto &[grantee, ids] : perms)
+      {
+         m_grants.push_back({grantee, static_cast<uint32_t>(m_permission_ids.size()), static_cast<uint32_t>(ids.size())});
+         m_permission_ids.insert(m_permission_ids.end(), ids.begin(), ids.end());
+      }
+      m_patients.push_back(entry);
+   }
+
+   void snapshot_writer::add_permission(const uint64_t patient, const uint64_t id, const std::vector<uint8_t> &specialtyids, const uint8_t right,
+                                        const uint32_t from, const uint32_t to)
+   {
+      permission_entry entry{};
+      entry.patient = patient;
+      entry.id = id;
+      entry.from = from;
+      entry.to = to;
+      entry.right = right;
+      for (const auto specialtyid : specialtyids)
+         entry.specialties[specialtyid / 64] |= uint64_t(1) << (specialtyid % 64);
+      m_permissions.push_back(entry);
+   }
+
+   void snapshot_writer::add_doctor(const uint64_t account, const uint8_t specialtyid, const std::string &pubenckey,
+                                    const std::vector<std::pair<uint64_t, std::string>> &grantedkeys)
+   {
+      doctor_entry entry{};
+      entry.account = account;
+      entry.pubenckey = intern(pubenckey);
+      entry.first_key = static_cast<uint32_t>(m_doctor_keys.size());
+      entry.keys_count = static_cast<uint32_t>(grantedkeys.size());
+      entry.specialtyid = specialtyid;
+      for (const auto &[patient, key] : grantedkeys)
+         m_doctor_keys.push_back({patient, intern(key)});
+      m_doctors.push_back(entry);
+   }
+
+   void snapshot_writer::add_record(const uint64_t patient, const uint8_t specialtyid, const uint32_t timestamp, const std::string &hash,
+                                    const uint64_t doctor, const std::string &description)
+   {
+      record_entry entry{};
+      entry.patient = patient;
+      entry.doctor = doctor;
+      entry.hash = intern(hash);
+      entry.description = intern(description);
+      entry.timestamp = timestamp;
+      entry.specialtyid = specialtyid;
+      m_records.push_back(entry);
+   }
+
+   bool snapshot_writer::write(const std::string &path, std::string &error)
+   {
+      if (m_strings.size() > std::numeric_limits<uint32_t>::max() || m_records.size() > std::numeric_limits<uint32_t>::max())
+      {
+         error = "snapshot exceeds 4 GiB string pool or 2^32 records";
+         return false;
+      }
+
+      /* Sort by lookup keys; nested ranges are referenced by index, so they stay valid */
+      std::sort(m_patients.begin(), m_patients.end(), [](const auto &lhs, const auto &rhs) { return lhs.account < rhs.account; });
+      std::sort(m_doctors.begin(), m_doctors.end(), [](const auto &lhs, const auto &rhs) { return lhs.account < rhs.account; });
+      std::sort(m_permissions.begin(), m_permissions.end(), [](const auto &lhs, const auto &rhs) {
+         return lhs.patient < rhs.patient || (lhs.patient == rhs.patient && lhs.id < rhs.id);
+      });
+      std::stable_sort(m_records.begin(), m_records.end(), [](const auto &lhs, const auto &rhs) {
+         return lhs.patient < rhs.patient || (lhs.patient == rhs.patient && lhs.specialtyid < rhs.specialtyid);
+      });
+
+      std::vector<record_span> spans;
+      for (uint32_t i = 0; i < m_records.size(); i++)
+      {
+         if (spans.empty() || spans.back().patient != m_records[i].patient || spans.back().specialtyid != m_records[i].specialtyid)
+         {
+            record_span span{};
+            span.patient = m_records[i].patient;
+            span.first_record = i;
+            span.specialtyid = m_records[i].specialtyid;
+            spans.push_back(span);
+         }
+         spans.back().records_count++;
+      }
+
+      const std::pair<const void *, uint64_t> contents[SECTIONS_COUNT] = {
+          {m_strings.data(), m_strings.size()},
+          {m_patients.data(), m_patients.size()},
+          {m_grants.data(), m_grants.size()},
+          {m_permission_ids.data(), m_permission_ids.size()},
+          {m_permissions.data(), m_permissions.size()},
+          {m_doctors.data(), m_doctors.size()},
+          {m_doctor_keys.data(), m_doctor_keys.size()},
+          {m_records.data(), m_records.size()},
+          {spans.data(), spans.size()}};
+
+      header file_header{};
+      std::memcpy(file_header.magic, MAGIC, sizeof(MAGIC));
+      file_header.version = FORMAT_VERSION;
+      file_header.sections_count = SECTIONS_COUNT;
+      uint64_t offset = align(sizeof(header));
+      for (uint32_t kind = 0; kind < SECTIONS_COUNT; kind++)
+      {
+         file_header.sections[kind] = {kind, ELEMENT_SIZES[kind], offset, contents[kind].second};
+         offset = align(offset + contents[kind].second * ELEMENT_SIZES[kind]);
+      }
+      file_header.file_size = offset;
+
+      std::ofstream file{path, std::ios::binary | std::ios::trunc};
+      if (!file)
+      {
+         error = "can't create " + path;
+         return false;
+      }
+      static const char padding[SECTION_ALIGNMENT] = {};
+      file.write(reinterpret_cast<const char *>(&file_header), sizeof(file_header));
+      file.write(padding, align(sizeof(header)) - sizeof(header));
+      for (uint32_t kind = 0; kind < SECTIONS_COUNT; kind++)
+      {
+         const auto size = contents[kind].second * ELEMENT_SIZES[kind];
+         file.write(static_cast<const char *>(contents[kind].first), static_cast<std::streamsize>(size));
+         file.write(padding, static_cast<std::streamsize>(align(size) - size));
+      }
+      if (!file.flush())
+      {
+         error = "can't write " + path;
+         return false;
+      }
+      return true;
+   }
+} // namespace snapshot
@@ -0,0 +1,246 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+   Binary snapshot of contract tables, designed to be memory mapped and used in place
+   File starts with a header followed by a table of sections; each section is an array of fixed width entries,
+   8 byte aligned, sorted by the keys the contract uses to look rows up. Variable length data is kept in a
+   string pool and referenced by offset and length, nested collections are flattened into their own sections
+   and referenced by index of first entry and count. All integers are little endian
+*/
+namespace snapshot
+{
+   static constexpr inline char MAGIC[8] = {'M', 'E', 'D', 'S', 'N', 'A', 'P', '\0'};
+   /* Version 2 keeps encryption keys as their bytes, as the contract stores them since its schema version 4 */
+   static constexpr inline uint32_t FORMAT_VERSION = 2;
+
+   enum section_kind : uint32_t
+   {
+      STRINGS,
+      PATIENTS,
+      GRANTS,
+      PERMISSION_IDS,
+      PERMISSIONS,
+      DOCTORS,
+      DOCTOR_KEYS,
+      RECORDS,
+      RECORD_SPANS,
+      SECTIONS_COUNT
+   };
+
+   struct section_entry
+   {
+      uint32_t kind;
+      /* Size of one entry, checked against layout of loader */
+      uint32_t element_size;
+      uint64_t offset;
+      uint64_t count;
+   };
+
+   struct header
+   {
+      char magic[8];
+      uint32_t version;
+      uint32_t sections_count;
+      uint64_t file_size;
+      section_entry sections[SECTIONS_COUNT];
+   };
+
+   /* Slice of string pool */
+   struct string_ref
+   {
+      uint32_t offset;
+      uint32_t length;
+   };
+
+   /* Row of patients table */
+   struct patient_entry
+   {
+      uint64_t account;
+      /* Key bytes, DER encoded */
+      string_ref pubenckey;
+      /* Range of grants section, accounts to which patient granted permissions */
+      uint32_t first_grant;
+      uint32_t grants_count;
+   };
+
+   /* Entry of patient perms map, account -> permission ids */
+   struct grant_entry
+   {
+      uint64_t grantee;
+      /* Range of permission ids section */
+      uint32_t first_permission_id;
+      uint32_t permission_ids_count;
+   };
+
+   /* Row of permissions table, sorted by patient scope and id */
+   struct permission_entry
+   {
+      uint64_t patient;
+      uint64_t id;
+      uint32_t from;
+      uint32_t to;
+      uint8_t right;
+      uint8_t padding[7];
+      /* Bitmap of specialty ids, specialty ids are uint8 so the set has fixed width */
+      uint64_t specialties[4];
+
+      bool has_specialty(const uint8_t specialtyid) const noexcept
+      {
+         return (specialties[specialtyid / 64] >> (specialtyid % 64)) & 1;
+      }
+   };
+
+   /* Row of doctors table */
+   struct doctor_entry
+   {
+      uint64_t account;
+      /* Key bytes, DER encoded */
+      string_ref pubenckey;
+      /* Range of doctor keys section */
+      uint32_t first_key;
+      uint32_t keys_count;
+      uint8_t specialtyid;
+      uint8_t padding[7];
+   };
+
+   /* Entry of doctor granted keys map, patient -> AES key */
+   struct doctor_key_entry
+   {
+      uint64_t patient;
+      string_ref key;
+   };
+
+   /* Record details, sorted by patient and specialty, in chart order within specialty */
+   struct record_entry
+   {
+      uint64_t patient;
+      uint64_t doctor;
+      string_ref hash;
+      string_ref description;
+      uint32_t timestamp;
+      uint8_t specialtyid;
+      uint8_t padding[3];
+   };
+
+   /* Offset index of records, one span per patient and specialty, sorted the same way as records */
+   struct record_span
+   {
+      uint64_t patient;
+      uint32_t first_record;
+      uint32_t records_count;
+      uint8_t specialtyid;
+      uint8_t padding[7];
+   };
+
+   /* Read only view over an array of snapshot entries */
+   template <typename T>
+   class array_view
+   {
+   public:
+      array_view() noexcept = default;
+      array_view(const T *data, const size_t size) noexcept : m_data{data}, m_size{size}
+      {
+      }
+
+      const T *begin() const noexcept { return m_data; }
+      const T *end() const noexcept { return m_data + m_size; }
+      size_t size() const noexcept { return m_size; }
+      bool empty() const noexcept { return m_size == 0; }
+      const T &operator[](const size_t index) const noexcept { return m_data[index]; }
+
+      /* Subrange [first, first + count), empty when it exceeds the view */
+      array_view slice(const uint64_t first, const uint64_t count) const noexcept
+      {
+         if (first > m_size || count > m_size - first)
+            return {};
+         return {m_data + first, static_cast<size_t>(count)};
+      }
+
+   private:
+      const T *m_data = nullptr;
+      size_t m_size = 0;
+   };
+
+   /*
+      Memory mapped snapshot
+      Opening validates only the header and section bounds, so it takes the same time regardless of snapshot
+      size; pages are brought in by the kernel as entries are touched
+   */
+   class mapped_snapshot
+   {
+   public:
+      mapped_snapshot() noexcept = default;
+      mapped_snapshot(const mapped_snapshot &) = delete;
+      mapped_snapshot &operator=(const mapped_snapshot &) = delete;
+      ~mapped_snapshot();
+
+      bool open(const std::string &path, std::string &error);
+
+      array_view<patient_entry> patients() const noexcept { return section<patient_entry>(PATIENTS); }
+      array_view<permission_entry> permissions() const noexcept { return section<permission_entry>(PERMISSIONS); }
+      array_view<doctor_entry> doctors() const noexcept { return section<doctor_entry>(DOCTORS); }
+      array_view<record_entry> records() const noexcept { return section<record_entry>(RECORDS); }
+      array_view<record_span> record_spans() const noexcept { return section<record_span>(RECORD_SPANS); }
+
+      std::string_view string(const string_ref &ref) const noexcept;
+
+      const patient_entry *find_patient(uint64_t account) const noexcept;
+      const doctor_entry *find_doctor(uint64_t account) const noexcept;
+      array_view<grant_entry> grants(const patient_entry &patient) const noexcept;
+      array_view<uint64_t> permission_ids(const grant_entry &grant) const noexcept;
+      /* Permissions of patient scope */
+      array_view<permission_entry> permissions(uint64_t patient) const noexcept;
+      array_view<doctor_key_entry> keys(const doctor_entry &doctor) const noexcept;
+      /* All records of patient, grouped by specialty */
+      array_view<record_entry> records(uint64_t patient) const noexcept;
+      array_view<record_entry> records(uint64_t patient, uint8_t specialtyid) const noexcept;
+
+   private:
+      template <typename T>
+      array_view<T> section(const section_kind kind) const noexcept
+      {
+         if (m_header == nullptr)
+            return {};
+         const auto &entry = m_header->sections[kind];
+         return {reinterpret_cast<const T *>(m_data + entry.offset), static_cast<size_t>(entry.count)};
+      }
+
+      const char *m_data = nullptr;
+      size_t m_size = 0;
+      const header *m_header = nullptr;
+   };
+
+   /* Builds snapshot in memory, entries can be added in any order and are sorted when written */
+   class snapshot_writer
+   {
+   public:
+      snapshot_writer();
+
+      void add_patient(uint64_t account, const std::string &pubenckey, const std::vector<std::pair<uint64_t, std::vector<uint64_t>>> &perms);
+      void add_permission(uint64_t patient, uint64_t id, const std::vector<uint8_t> &specialtyids, uint8_t right, uint32_t from, uint32_t to);
+      void add_doctor(uint64_t account, uint8_t specialtyid, const std::string &pubenckey, const std::vector<std::pair<uint64_t, std::string>> &grantedkeys);
+      /* Records of a specialty must be added in chart order */
+      void add_record(uint64_t patient, uint8_t specialtyid, uint32_t timestamp, const std::string &hash, uint64_t doctor, const std::string &description);
+
+      bool write(const std::string &path, std::string &error);
+
+   private:
+      string_ref intern(const std::string &text);
+
+      std::string m_strings;
+      std::unordered_map<std::string, string_ref> m_interned;
+      std::vector<patient_entry> m_patients;
+      std::vector<grant_entry> m_grants;
+      std::vector<uint64_t> m_permission_ids;
+      std::vector<permission_entry> m_permissions;
+      std::vector<doctor_entry> m_doctors;
+      std::vector<doctor_key_entry> m_doctor_keys;
+      std::vector<record_entry> m_records;
+   };
+} // namespace snapshot
@@ -0,0 +1,141 @@
+#include "tables.hpp"
+#include "json.hpp"
+#include "packed_reader.hpp"
+#include "medical.hpp"
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+   bool read_file(const std::string &path, std::string &content, std::string &error)
+   {
+      std::ifstream file{path, std::ios::binary};
+      if (!file)
+      {
+         error = "can't open " + path;
+         return false;
+      }
+      content.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+      return true;
+   }
+
+   /* Loads rows array of cleos get table output */
+   bool read_rows(const std::string &path, json_value &document, const json_value *&rows, std::string &error)
+   {
+      std::string json;
+      if (!read_file(path, json, error))
+         return false;
+      if (!parse_json(json, document, error))
+      {
+         error = path + ": " + error;
+         return false;
+      }
+      rows = document.find("rows");
+      if (rows == nullptr || rows->kind != json_value::ARRAY)
+      {
+         error = path + ": rows are missing";
+         return false;
+      }
+      return true;
+   }
+
+   /* Unpacks packed row into the row struct of the contract, which must consume it whole */
+   template <typename Row>
+   bool unpack_row(const char *data, const size_t size, Row &row)
+   {
+      try
+      {
+         eosio::datastream<const char *> ds{data, size};
+         ds >> row;
+         return ds.remaining() == 0;
+      }
+      catch (const std::exception &)
+      {
+         /* Emulated eosio_assert throws on rows shorter than their layout */
+         return false;
+      }
+   }
+
+   /* Visits every row of cleos get table --binary output, unpacked into the row struct of the contract */
+   template <typename Row, typename Visitor>
+   bool for_each_row(const std::string &path, std::string &error, Visitor visitor)
+   {
+      json_value document;
+      const json_value *rows;
+      if (!read_rows(path, document, rows, error))
+         return false;
+      for (size_t i = 0; i < rows->elements.size(); i++)
+      {
+         std::string bytes;
+         Row row{};
+         if (!rows->elements[i].as_bytes(bytes) || !unpack_row(bytes.data(), bytes.size(), row))
+         {
+            error = path + ": row " + std::to_string(i) + " is not a packed row of the table";
+            return false;
+         }
+         visitor(row);
+      }
+      return true;
+   }
+
+   std::string key_bytes(const std::vector<uint8_t> &key)
+   {
+      return {key.begin(), key.end()};
+   }
+} // namespace
+
+bool load_patients_json(const std::string &path, snapshot::snapshot_writer &writer, std::string &error)
+{
+   return for_each_row<medical::patient>(path, error, [&writer](const medical::patient &patient) {
+      std::vector<std::pair<uint64_t, std::vector<uint64_t>>> perms;
+      for (const auto &[grantee, ids] : patient.perms)
+         perms.emplace_back(grantee.value, ids);
+      writer.add_patient(patient.account.value, key_bytes(patient.pubenckey), perms);
+   });
+}
+
+bool load_doctors_json(const std::string &path, snapshot::snapshot_writer &writer, std::string &error)
+{
+   return for_each_row<medical::doctor>(path, error, [&writer](const medical::doctor &doctor) {
+      std::vector<std::pair<uint64_t, std::string>> grantedkeys;
+      for (const auto &[patient, key] : doctor.grantedkeys)
+         grantedkeys.emplace_back(patient.value, key_bytes(key));
+      writer.add_doctor(doctor.account.value, doctor.specialtyid, key_bytes(doctor.pubenckey), grantedkeys);
+   });
+}
+
+bool load_permissions_json(const std::string &path, const uint64_t patient, snapshot::snapshot_writer &writer, std::string &error)
+{
+   return for_each_row<medical::permission>(path, error, [patient, &writer](const medical::permission &permission) {
+      writer.add_permission(patient, permission.id, permission.specialtyids, permission.right, permission.interval.from, permission.interval.to);
+   });
+}
+
+bool load_records_dump(const std::string &path, const removed_records &removed, snapshot::snapshot_writer &writer, std::string &error)
+{
+   std::string dump;
+   if (!read_file(path, dump, error))
+      return false;
+
+   const auto end = for_each_dumped_row(dump, [&removed, &writer](packed_reader &row) {
+      medical::record record{};
+      if (!unpack_row(row.data(), row.remaining(), record))
+         return false;
+      for (const auto &[specialtyid, details] : record.details)
+      {
+         for (size_t position = 0; position < details.size(); position++)
+         {
+            const auto &detail = details[position];
+            if (!removed.contains(record.patient.value, specialtyid, static_cast<uint32_t>(position)))
+               writer.add_record(record.patient.value, specialtyid, detail.timestamp, detail.hash, detail.doctor.value, detail.description);
+         }
+      }
+      return true;
+   });
+   if (end != dump.size())
+   {
+      error = path + ": malformed row at offset " + std::to_string(end);
+      return false;
+   }
+   return true;
+}
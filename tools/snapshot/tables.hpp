@@ -0,0 +1,25 @@
+#pragma once
+#include "snapshot.hpp"
+#include "tombstones.hpp"
+#include <string>
+
+/*
+   Loaders of contract tables into snapshot writer
+   Rows are unpacked into patient, doctor, permission and record structs of medical.hpp, compiled against host emulation
+   of eosiolib, so loaders follow layouts of the contract
+*/
+
+/* Rows of patients table, as printed by cleos get table --binary */
+bool load_patients_json(const std::string &path, snapshot::snapshot_writer &writer, std::string &error);
+
+/* Rows of doctors table, as printed by cleos get table --binary */
+bool load_doctors_json(const std::string &path, snapshot::snapshot_writer &writer, std::string &error);
+
+/* Rows of permissions table scoped by patient, as printed by cleos get table --binary */
+bool load_permissions_json(const std::string &path, uint64_t patient, snapshot::snapshot_writer &writer, std::string &error);
+
+/*
+   Binary dump of records table, every packed row prefixed by its uint32 little endian size; table is not in the abi
+   Removed records which are still in the dump are skipped
+*/
+bool load_records_dump(const std::string &path, const removed_records &removed, snapshot::snapshot_writer &writer, std::string &error);